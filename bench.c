@@ -35,6 +35,7 @@
 #include <string.h>      /* memset */
 #include <stdio.h>       /* fprintf, fopen */
 #include <assert.h>      /* assert */
+#include <math.h>        /* sqrt, ceil */
 
 #include "mem.h"
 #include "zfgen.h"     /* RDG_genBuffer */
@@ -60,6 +61,7 @@
 #define GB *(1U<<30)
 
 #define BMK_RUNTEST_DEFAULT_MS 1000
+#define BMK_BOOTSTRAP_ROUNDS  2000
 
 
 /* *************************************
@@ -124,6 +126,39 @@ static BMK_runOutcome_t BMK_setValid_runTime(BMK_runTime_t runTime)
 }
 
 
+/* optional functions, invoked around the timed section of each run */
+typedef struct {
+    BMK_runHookFn_t startFn;
+    BMK_runHookFn_t endFn;
+    void* payload;
+} BMK_runHooks_t;
+
+/* cold mode : evict all blocks before each iteration */
+static void BMK_evictBlocks(unsigned coldFlags,
+                            size_t blockCount,
+                            const void* const * srcBlockBuffers, const size_t* srcBlockSizes,
+                            void* const * dstBlockBuffers, const size_t* dstBlockCapacities)
+{
+    size_t blockNb;
+    for (blockNb = 0; blockNb < blockCount; blockNb++) {
+        UTIL_flushCache(srcBlockBuffers[blockNb], srcBlockSizes[blockNb]);
+        UTIL_flushCache(dstBlockBuffers[blockNb], dstBlockCapacities[blockNb]);
+    }
+    if (coldFlags & BMK_cold_tlb) UTIL_evictTLB();
+}
+
+static BMK_runOutcome_t BMK_benchFunction_internal(
+            BMK_benchFn_t benchFn, void* benchPayload,
+            BMK_initFn_t initFn, void* initPayload,
+            size_t blockCount,
+            const void* const * srcBlockBuffers, const size_t* srcBlockSizes,
+            void* const * dstBlockBuffers, const size_t* dstBlockCapacities,
+            size_t* blockResults,
+            unsigned nbLoops,
+            const BMK_runHooks_t* hooks,
+            unsigned coldFlags,
+            int useTSC);
+
 /* initFn will be measured once, benchFn will be measured `nbLoops` times */
 /* initFn is optional, provide NULL if none */
 /* benchFn must return size_t field  */
@@ -139,6 +174,28 @@ BMK_runOutcome_t BMK_benchFunction(
             void* const * dstBlockBuffers, const size_t* dstBlockCapacities,
             size_t* blockResults,
             unsigned nbLoops)
+{
+    return BMK_benchFunction_internal(benchFn, benchPayload,
+                                      initFn, initPayload,
+                                      blockCount,
+                                      srcBlockBuffers, srcBlockSizes,
+                                      dstBlockBuffers, dstBlockCapacities,
+                                      blockResults,
+                                      nbLoops,
+                                      NULL, 0, 0);
+}
+
+static BMK_runOutcome_t BMK_benchFunction_internal(
+            BMK_benchFn_t benchFn, void* benchPayload,
+            BMK_initFn_t initFn, void* initPayload,
+            size_t blockCount,
+            const void* const * srcBlockBuffers, const size_t* srcBlockSizes,
+            void* const * dstBlockBuffers, const size_t* dstBlockCapacities,
+            size_t* blockResults,
+            unsigned nbLoops,
+            const BMK_runHooks_t* hooks,
+            unsigned coldFlags,
+            int useTSC)
 {
     size_t sumOfReturn = 0;
 
@@ -161,22 +218,37 @@ BMK_runOutcome_t BMK_benchFunction(
     }
 
     /* benchmark */
-    {   UTIL_time_t const clockStart = UTIL_getTime();
-        unsigned loopNb, blockNb;
-        if (initFn != NULL) initFn(initPayload);
-        for (loopNb = 0; loopNb < nbLoops; loopNb++) {
-            for (blockNb = 0; blockNb < blockCount; blockNb++) {
-                size_t const res = benchFn(srcBlockBuffers[blockNb], srcBlockSizes[blockNb],
-                                           dstBlockBuffers[blockNb], dstBlockCapacities[blockNb],
-                                           benchPayload);
-                if (loopNb == 0) {
-                    sumOfReturn += res;
-                    if (blockResults != NULL) blockResults[blockNb] = res;
-            }   }
-        }  /* for (loopNb = 0; loopNb < nbLoops; loopNb++) */
-
-        {   U64 const totalTime = UTIL_clockSpanNano(clockStart);
-            BMK_runTime_t rt;
+    {   /* cold mode : each iteration is timed separately, after eviction */
+        unsigned const nbSections = coldFlags ? nbLoops : 1;
+        unsigned const loopsPerSection = coldFlags ? 1 : nbLoops;
+        U64 totalTime = 0;
+        unsigned sectionNb, loopNb, blockNb;
+        for (sectionNb = 0; sectionNb < nbSections; sectionNb++) {
+            if (coldFlags)
+                BMK_evictBlocks(coldFlags, blockCount,
+                                srcBlockBuffers, srcBlockSizes,
+                                dstBlockBuffers, dstBlockCapacities);
+            if (hooks != NULL && hooks->startFn != NULL) hooks->startFn(hooks->payload, loopsPerSection);
+            {   UTIL_time_t const clockStart = UTIL_getTime();
+                U64 const tscStart = useTSC ? UTIL_readTSC() : 0;
+                if (initFn != NULL && sectionNb == 0) initFn(initPayload);
+                for (loopNb = 0; loopNb < loopsPerSection; loopNb++) {
+                    for (blockNb = 0; blockNb < blockCount; blockNb++) {
+                        size_t const res = benchFn(srcBlockBuffers[blockNb], srcBlockSizes[blockNb],
+                                                   dstBlockBuffers[blockNb], dstBlockCapacities[blockNb],
+                                                   benchPayload);
+                        if (sectionNb == 0 && loopNb == 0) {
+                            sumOfReturn += res;
+                            if (blockResults != NULL) blockResults[blockNb] = res;
+                    }   }
+                }  /* for (loopNb = 0; loopNb < loopsPerSection; loopNb++) */
+                totalTime += useTSC ? UTIL_tscSpanNano(tscStart, UTIL_readTSC())
+                                    : UTIL_clockSpanNano(clockStart);
+            }
+            if (hooks != NULL && hooks->endFn != NULL) hooks->endFn(hooks->payload, loopsPerSection);
+        }
+
+        {   BMK_runTime_t rt;
             rt.nanoSecPerRun = totalTime / nbLoops;
             rt.sumOfReturn = sumOfReturn;
             return BMK_setValid_runTime(rt);
@@ -193,17 +265,50 @@ struct BMK_timedFnState_s {
     BMK_runTime_t fastestRun;
     unsigned nbLoops;
     UTIL_time_t coolTime;
+    BMK_runHooks_t hooks;
+    unsigned coldFlags;
+    int useTSC;
+    U64* samples;           /* nanoSecPerRun of each reported run */
+    size_t nbSamples;
+    size_t samplesCapacity;
 };  /* typedef'd to BMK_timedFnState_t within bench.h */
 
 BMK_timedFnState_t* BMK_createTimedFnState(unsigned total_ms, unsigned run_ms)
 {
     BMK_timedFnState_t* const r = (BMK_timedFnState_t*)malloc(sizeof(*r));
     if (r == NULL) return NULL;   /* malloc() error */
+    r->samples = NULL;
+    r->samplesCapacity = 0;
     BMK_resetTimedFnState(r, total_ms, run_ms);
+    BMK_setTimedFnHooks(r, NULL, NULL, NULL);
+    BMK_setTimedFnColdRuns(r, 0);
+    BMK_setTimedFnTSC(r, 0);
     return r;
 }
 
+int BMK_setTimedFnTSC(BMK_timedFnState_t* timedFnState, int useTSC)
+{
+    if (useTSC && UTIL_tscFrequency() <= 0) return 1;
+    timedFnState->useTSC = useTSC;
+    return 0;
+}
+
+void BMK_setTimedFnColdRuns(BMK_timedFnState_t* timedFnState, unsigned coldFlags)
+{
+    timedFnState->coldFlags = coldFlags;
+}
+
+void BMK_setTimedFnHooks(BMK_timedFnState_t* timedFnState,
+                         BMK_runHookFn_t startFn, BMK_runHookFn_t endFn, void* hookPayload)
+{
+    timedFnState->hooks.startFn = startFn;
+    timedFnState->hooks.endFn = endFn;
+    timedFnState->hooks.payload = hookPayload;
+}
+
 void BMK_freeTimedFnState(BMK_timedFnState_t* state) {
+    if (state == NULL) return;
+    free(state->samples);
     free(state);
 }
 
@@ -219,6 +324,7 @@ void BMK_resetTimedFnState(BMK_timedFnState_t* timedFnState, unsigned total_ms,
     timedFnState->fastestRun.sumOfReturn = (size_t)(-1LL);
     timedFnState->nbLoops = 1;
     timedFnState->coolTime = UTIL_getTime();
+    timedFnState->nbSamples = 0;
 }
 
 /* Tells if nb of seconds set in timedFnState for all runs is spent.
@@ -231,6 +337,20 @@ int BMK_isCompleted_TimedFn(const BMK_timedFnState_t* timedFnState)
 
 #define MINUSABLETIME  (TIMELOOP_NANOSEC / 2)  /* 0.5 seconds */
 
+/* samples are only used for statistics :
+ * on allocation failure, the sample is dropped */
+static void BMK_addSample(BMK_timedFnState_t* cont, U64 nanoSecPerRun)
+{
+    if (cont->nbSamples == cont->samplesCapacity) {
+        size_t const newCapacity = cont->samplesCapacity ? cont->samplesCapacity * 2 : 64;
+        U64* const newSamples = (U64*)realloc(cont->samples, newCapacity * sizeof(*newSamples));
+        if (newSamples == NULL) return;
+        cont->samples = newSamples;
+        cont->samplesCapacity = newCapacity;
+    }
+    cont->samples[cont->nbSamples++] = nanoSecPerRun;
+}
+
 #undef MIN
 #define MIN(a,b)    ((a) < (b) ?  (a) : (b))
 
@@ -259,13 +379,16 @@ BMK_runOutcome_t BMK_benchTimedFn(
         }
 
         /* reinitialize capacity */
-        runResult = BMK_benchFunction(benchFn, benchPayload,
+        runResult = BMK_benchFunction_internal(benchFn, benchPayload,
                                     initFn, initPayload,
                                     blockCount,
                                     srcBlockBuffers, srcBlockSizes,
                                     dstBlockBuffers, dstBlockCapacities,
                                     blockResults,
-                                    cont->nbLoops);
+                                    cont->nbLoops,
+                                    &cont->hooks,
+                                    cont->coldFlags,
+                                    cont->useTSC);
 
         if(!BMK_isSuccessful_runOutcome(runResult)) { /* error : move out */
             return BMK_runOutcome_error();
@@ -295,6 +418,7 @@ BMK_runOutcome_t BMK_benchTimedFn(
                 if(newRunTime.nanoSecPerRun < bestRunTime.nanoSecPerRun) {
                     bestRunTime = newRunTime;
                 }
+                BMK_addSample(cont, newRunTime.nanoSecPerRun);
                 completed = 1;
             }
         }
@@ -302,3 +426,103 @@ BMK_runOutcome_t BMK_benchTimedFn(
 
     return BMK_setValid_runTime(bestRunTime);
 }
+
+
+/* ====  Statistics over all runs of a timed session  ==== */
+
+static int BMK_cmpDouble(const void* a, const void* b)
+{
+    double const x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void BMK_sortDoubles(double* values, size_t nbValues)
+{
+    qsort(values, nbValues, sizeof(*values), BMK_cmpDouble);
+}
+
+double BMK_percentile(const double* sorted, size_t nbValues, double q)
+{
+    size_t rank = (size_t)ceil(q * (double)nbValues);
+    assert(nbValues > 0);
+    if (rank == 0) rank = 1;
+    return sorted[rank - 1];
+}
+
+/* note : sorts `values` */
+static double BMK_median(double* values, size_t nbValues)
+{
+    assert(nbValues > 0);
+    BMK_sortDoubles(values, nbValues);
+    if (nbValues & 1) return values[nbValues / 2];
+    return (values[nbValues / 2 - 1] + values[nbValues / 2]) / 2;
+}
+
+/* fixed seed : results must be reproducible */
+unsigned BMK_rand(unsigned* state)
+{
+    U32 x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+BMK_runStats_t BMK_getRunStats(const BMK_timedFnState_t* timedFnState, double confidence)
+{
+    size_t const n = timedFnState->nbSamples;
+    BMK_runStats_t st;
+    memset(&st, 0, sizeof(st));
+    st.nbRuns = (unsigned)n;
+    if (n == 0) return st;
+    assert(confidence > 0. && confidence < 1.);
+
+    {   double* const values = (double*)malloc(n * sizeof(*values));
+        double* const resample = (double*)malloc(n * sizeof(*resample));
+        double* const medians = (double*)malloc(BMK_BOOTSTRAP_ROUNDS * sizeof(*medians));
+        double sum = 0, sqSum = 0;
+        size_t i;
+        if (values == NULL || resample == NULL || medians == NULL) {
+            free(values); free(resample); free(medians);
+            st.nbRuns = 0;
+            return st;
+        }
+
+        for (i = 0; i < n; i++) {
+            values[i] = (double)timedFnState->samples[i];
+            sum += values[i];
+        }
+        st.mean_ns = sum / n;
+        for (i = 0; i < n; i++) sqSum += (values[i] - st.mean_ns) * (values[i] - st.mean_ns);
+        st.stddev_ns = (n > 1) ? sqrt(sqSum / (n - 1)) : 0;
+        st.median_ns = BMK_median(values, n);
+        st.min_ns = values[0];   /* values are now sorted */
+
+        /* percentile bootstrap of the median */
+        {   unsigned seed = 2654435761U;
+            int r;
+            for (r = 0; r < BMK_BOOTSTRAP_ROUNDS; r++) {
+                for (i = 0; i < n; i++) resample[i] = values[BMK_rand(&seed) % n];
+                medians[r] = BMK_median(resample, n);
+            }
+            BMK_sortDoubles(medians, BMK_BOOTSTRAP_ROUNDS);
+            {   double const tail = (1. - confidence) / 2;
+                size_t const low = (size_t)(tail * (BMK_BOOTSTRAP_ROUNDS - 1));
+                size_t const high = (size_t)((1. - tail) * (BMK_BOOTSTRAP_ROUNDS - 1) + 0.5);
+                st.ciLow_ns = medians[low];
+                st.ciHigh_ns = medians[high];
+        }   }
+
+        free(values);
+        free(resample);
+        free(medians);
+    }
+    return st;
+}
+
+int BMK_isSignificant(BMK_runStats_t a, BMK_runStats_t b)
+{
+    if (a.nbRuns < BMK_SIGNIFICANT_RUNS_MIN || b.nbRuns < BMK_SIGNIFICANT_RUNS_MIN) return 0;
+    return (a.ciHigh_ns < b.ciLow_ns) || (b.ciHigh_ns < a.ciLow_ns);
+}
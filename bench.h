@@ -113,6 +113,38 @@ void BMK_resetTimedFnState(BMK_timedFnState_t* timedFnState, unsigned total_ms,
 void BMK_freeTimedFnState(BMK_timedFnState_t* state);
 
 
+/* BMK_setTimedFnHooks() :
+ * Optional functions, invoked by BMK_benchTimedFn() right before and right after
+ * the timed section of each run, for example to collect hardware counters.
+ * Both receive `hookPayload`, and the nb of loops of the run.
+ * Any function can be NULL. Hooks are disabled by default.
+ */
+typedef void (*BMK_runHookFn_t)(void* hookPayload, unsigned nbLoops);
+void BMK_setTimedFnHooks(BMK_timedFnState_t* timedFnState,
+                         BMK_runHookFn_t startFn, BMK_runHookFn_t endFn, void* hookPayload);
+
+
+/* BMK_setTimedFnColdRuns() :
+ * In cold mode, BMK_benchTimedFn() times each iteration of benchFn separately,
+ * after flushing all src and dst blocks from the cache hierarchy (BMK_cold_caches),
+ * and optionally after evicting the data TLB (BMK_cold_tlb).
+ * Flushing is not part of measured time, nor of hooked section.
+ * `coldFlags` : bitwise OR of BMK_coldFlags_e; 0 (default) disables cold mode.
+ */
+typedef enum {
+    BMK_cold_caches = 1,
+    BMK_cold_tlb    = 2
+} BMK_coldFlags_e;
+void BMK_setTimedFnColdRuns(BMK_timedFnState_t* timedFnState, unsigned coldFlags);
+
+
+/* BMK_setTimedFnTSC() :
+ * time runs with the time-stamp counter instead of the monotonic clock.
+ * Results are still expressed in nanoseconds, converted with calibrated TSC frequency.
+ * @return : 0 on success, 1 if TSC is not available or not invariant (clock is unchanged) */
+int BMK_setTimedFnTSC(BMK_timedFnState_t* timedFnState, int useTSC);
+
+
 /* Tells if duration of all benchmark runs has exceeded total_ms
  */
 int BMK_isCompleted_TimedFn(const BMK_timedFnState_t* timedFnState);
@@ -136,6 +168,42 @@ BMK_runOutcome_t BMK_benchTimedFn(
                     size_t* blockResults);
 
 
+/* BMK_runStats_t :
+ * distribution of all results produced by BMK_benchTimedFn()
+ * since last reset, expressed in nanoseconds per run.
+ * [ciLow_ns, ciHigh_ns] is a bootstrap confidence interval of the median. */
+typedef struct {
+    unsigned nbRuns;
+    double min_ns;
+    double median_ns;
+    double mean_ns;
+    double stddev_ns;
+    double ciLow_ns;
+    double ciHigh_ns;
+} BMK_runStats_t;
+
+#define BMK_CONFIDENCE_DEFAULT 0.95
+
+/* BMK_getRunStats() :
+ * `confidence` : level of the confidence interval, in ]0, 1[.
+ * Resampling is deterministic : same samples always produce same interval. */
+BMK_runStats_t BMK_getRunStats(const BMK_timedFnState_t* timedFnState, double confidence);
+
+/* BMK_isSignificant() :
+ * @return 1 if medians of `a` and `b` differ in a statistically significant way,
+ *         which requires both confidence intervals to be disjoint.
+ *         Sessions with too few runs are never considered significant. */
+#define BMK_SIGNIFICANT_RUNS_MIN 3
+int BMK_isSignificant(BMK_runStats_t a, BMK_runStats_t b);
+
+/* helpers for other distributions of samples :
+ * BMK_sortDoubles() : ascending order.
+ * BMK_percentile() : nearest rank, `q` in [0, 1], `sorted` must be sorted and not empty.
+ * BMK_rand() : xorshift32, for reproducible resampling and shuffles; `*state` must not be 0 */
+void BMK_sortDoubles(double* values, size_t nbValues);
+double BMK_percentile(const double* sorted, size_t nbValues, double q);
+unsigned BMK_rand(unsigned* state);
+
 
 
 
@@ -0,0 +1,344 @@
+/*
+ * Cache and TLB model, see cachesim.h
+ */
+
+#include <stddef.h>   /* ptrdiff_t */
+#include <stdlib.h>   /* calloc, malloc, free */
+#include <string.h>   /* memset */
+#include <assert.h>
+#include "cachesim.h"
+
+
+typedef unsigned long long U64;
+typedef unsigned U32;
+
+#define CSIM_EMPTY ((U32)-1)
+#define CSIM_LINE_LOG 6
+#define CSIM_PAGE_LOG 12
+
+typedef struct {
+    U32 tag;            /* low 32 bits of line or page number, enough below 256 GB */
+    U32 stamp;          /* last use, for LRU; 0 : never */
+    U64 ready : 63;     /* caches only : cycle the line arrives */
+    U64 pending : 1;    /* caches only : prefetched, not yet accessed */
+} entry_t;
+
+typedef struct {
+    size_t nbSets;
+    size_t setMask;     /* nbSets - 1 when it's a power of 2, 0 otherwise */
+    unsigned ways;
+    entry_t* entries;   /* nbSets x ways, a set is contiguous */
+} level_t;
+
+/* latest line or page of a tag, and its first level entry :
+ * sequential streams access the same line many times in a row,
+ * a matching entry tag confirms it's still there, without searching its set */
+typedef struct {
+    U64 block;
+    size_t idx;
+} memo_t;
+
+struct CSIM_s {
+    CSIM_config config;
+    level_t caches[CSIM_LEVELS_MAX];
+    level_t tlbs[CSIM_LEVELS_MAX];
+    memo_t lastLine[CSIM_TAGS_MAX];
+    memo_t lastPage[CSIM_TAGS_MAX];
+    U32 now;
+    CSIM_counters_t counters;
+};
+
+
+CSIM_config CSIM_defaultConfig(void)
+{
+    CSIM_config c;
+    memset(&c, 0, sizeof(c));
+    c.nbCaches = 3;
+    c.cache[0].size = 48 << 10;  c.cache[0].ways = 12;  c.cache[0].latency = 5;
+    c.cache[1].size = 2 << 20;   c.cache[1].ways = 16;  c.cache[1].latency = 16;
+    c.cache[2].size = 32 << 20;  c.cache[2].ways = 16;  c.cache[2].latency = 50;
+    c.memLatency = 250;
+    c.nbTlbs = 2;
+    c.tlb[0].size = 64;          c.tlb[0].ways = 4;     c.tlb[0].latency = 0;
+    c.tlb[1].size = 1536;        c.tlb[1].ways = 12;    c.tlb[1].latency = 7;
+    c.walkLatency = 30;
+    return c;
+}
+
+static int initLevel(level_t* level, size_t nbEntries, unsigned ways)
+{
+    if (ways == 0 || nbEntries == 0 || nbEntries % ways) return 1;
+    level->nbSets = nbEntries / ways;
+    level->setMask = (level->nbSets & (level->nbSets - 1)) ? 0 : level->nbSets - 1;
+    level->ways = ways;
+    level->entries = malloc(nbEntries * sizeof(entry_t));
+    return (level->entries == NULL);
+}
+
+static void resetLevel(level_t* level)
+{
+    size_t const nbEntries = level->nbSets * level->ways;
+    for (size_t n = 0; n < nbEntries; n++) {
+        level->entries[n].tag = CSIM_EMPTY;
+        level->entries[n].stamp = 0;
+        level->entries[n].ready = 0;
+        level->entries[n].pending = 0;
+    }
+}
+
+static void ageLevel(level_t* level)
+{
+    size_t const nbEntries = level->nbSets * level->ways;
+    for (size_t n = 0; n < nbEntries; n++) level->entries[n].stamp = (level->entries[n].tag != CSIM_EMPTY);
+}
+
+static void freeLevel(level_t* level)
+{
+    free(level->entries);
+}
+
+CSIM_t* CSIM_create(CSIM_config config)
+{
+    CSIM_t* const sim = calloc(1, sizeof(*sim));
+    int error = 0;
+    if (sim == NULL) return NULL;
+    if (config.nbCaches < 1 || config.nbCaches > CSIM_LEVELS_MAX
+      || config.nbTlbs < 0 || config.nbTlbs > CSIM_LEVELS_MAX) {
+        free(sim);
+        return NULL;
+    }
+    sim->config = config;
+    for (int l = 0; l < config.nbCaches; l++) {
+        if (config.cache[l].size % CSIM_LINE_SIZE) error = 1;
+        error |= initLevel(sim->caches + l, config.cache[l].size / CSIM_LINE_SIZE, config.cache[l].ways);
+    }
+    for (int l = 0; l < config.nbTlbs; l++)
+        error |= initLevel(sim->tlbs + l, config.tlb[l].size, config.tlb[l].ways);
+    if (error) {
+        CSIM_free(sim);
+        return NULL;
+    }
+    assert((1 << CSIM_LINE_LOG) == CSIM_LINE_SIZE && (1 << CSIM_PAGE_LOG) == CSIM_PAGE_SIZE);
+    CSIM_reset(sim);
+    return sim;
+}
+
+void CSIM_free(CSIM_t* sim)
+{
+    if (sim == NULL) return;
+    for (int l = 0; l < CSIM_LEVELS_MAX; l++) {
+        freeLevel(sim->caches + l);
+        freeLevel(sim->tlbs + l);
+    }
+    free(sim);
+}
+
+void CSIM_reset(CSIM_t* sim)
+{
+    for (int l = 0; l < sim->config.nbCaches; l++) resetLevel(sim->caches + l);
+    for (int l = 0; l < sim->config.nbTlbs; l++) resetLevel(sim->tlbs + l);
+    for (int t = 0; t < CSIM_TAGS_MAX; t++) {
+        sim->lastLine[t].block = sim->lastPage[t].block = (U64)-1;
+        sim->lastLine[t].idx = sim->lastPage[t].idx = 0;
+    }
+    sim->now = 0;
+    memset(&sim->counters, 0, sizeof(sim->counters));
+}
+
+/* when the 32-bit clock wraps, all entries become equally old, once every 4G accesses */
+static U32 nextStamp(CSIM_t* sim)
+{
+    if (++sim->now == 0) {
+        for (int l = 0; l < sim->config.nbCaches; l++) ageLevel(sim->caches + l);
+        for (int l = 0; l < sim->config.nbTlbs; l++) ageLevel(sim->tlbs + l);
+        sim->now = 1;
+    }
+    return sim->now;
+}
+
+static size_t firstEntry(const level_t* level, U64 block)
+{
+    size_t const set = (level->setMask || level->nbSets == 1) ? (size_t)block & level->setMask
+                                                              : (size_t)(block % level->nbSets);
+    return set * level->ways;
+}
+
+/* @return : index of `block` (line or page number), or -1 if absent.
+ * on absence, `*victim` receives the least recently used entry of its set,
+ * the one fillEntry() replaces, found within the same scan */
+static ptrdiff_t findEntry(const level_t* level, U64 block, size_t* victim)
+{
+    size_t const first = firstEntry(level, block);
+    const entry_t* const set = level->entries + first;
+    unsigned lru = 0;
+    /* empty entries have stamp 0 */
+    for (unsigned w = 0; w < level->ways; w++) {
+        if (set[w].tag == (U32)block) return (ptrdiff_t)(first + w);
+        lru = (set[w].stamp < set[lru].stamp) ? w : lru;
+    }
+    *victim = first + lru;
+    return -1;
+}
+
+/* replaces `victim`, from a missing findEntry()
+ * @return : index of `block` */
+static size_t fillEntry(CSIM_t* sim, level_t* level, size_t victim, U64 block, U32 stamp)
+{
+    sim->counters.pfEvicted += level->entries[victim].pending;
+    level->entries[victim].tag = (U32)block;
+    level->entries[victim].stamp = stamp;
+    level->entries[victim].ready = 0;
+    level->entries[victim].pending = 0;
+    return victim;
+}
+
+/* @return : translation cycles */
+static unsigned translate(CSIM_t* sim, U64 page, int tag)
+{
+    U32 const stamp = nextStamp(sim);
+    memo_t* const memo = sim->lastPage + tag;
+    size_t victims[CSIM_LEVELS_MAX];
+    int l;
+    if (sim->config.nbTlbs == 0) return 0;
+    sim->counters.pageAccesses[tag]++;
+    if (memo->block == page && sim->tlbs[0].entries[memo->idx].tag == (U32)page) {
+        sim->tlbs[0].entries[memo->idx].stamp = stamp;
+        return sim->config.tlb[0].latency;
+    }
+    for (l = 0; l < sim->config.nbTlbs; l++) {
+        ptrdiff_t const idx = findEntry(sim->tlbs + l, page, victims + l);
+        if (idx >= 0) {
+            sim->tlbs[l].entries[idx].stamp = stamp;
+            if (l == 0) memo->idx = (size_t)idx;
+            break;
+        }
+        sim->counters.tlbMisses[tag][l]++;
+    }
+    for (int f = 0; f < l; f++) {
+        size_t const e = fillEntry(sim, sim->tlbs + f, victims[f], page, stamp);
+        if (f == 0) memo->idx = e;
+    }
+    memo->block = page;
+    return (l < sim->config.nbTlbs) ? sim->config.tlb[l].latency : sim->config.walkLatency;
+}
+
+/* @return : first level holding `line`, or nbCaches; `*idx` : its entry,
+ * `victims` : entries to replace in the levels before it */
+static int findLine(const CSIM_t* sim, U64 line, ptrdiff_t* idx, size_t* victims)
+{
+    int l;
+    for (l = 0; l < sim->config.nbCaches; l++) {
+        *idx = findEntry(sim->caches + l, line, victims + l);
+        if (*idx >= 0) break;
+    }
+    return l;
+}
+
+/* @return : arrival cycle of `line`, requested at `cycle` from a cache level `l` (or memory) */
+static U64 arrivalFrom(const CSIM_t* sim, int l, ptrdiff_t idx, U64 cycle)
+{
+    U64 arrival;
+    if (l == sim->config.nbCaches) return cycle + sim->config.memLatency;
+    arrival = cycle + sim->config.cache[l].latency;
+    /* still in flight */
+    if (sim->caches[l].entries[idx].ready > arrival) arrival = sim->caches[l].entries[idx].ready;
+    return arrival;
+}
+
+/* @return : arrival cycle */
+static U64 demandLine(CSIM_t* sim, U64 line, int tag, U64 cycle)
+{
+    U32 const stamp = nextStamp(sim);
+    memo_t* const memo = sim->lastLine + tag;
+    size_t victims[CSIM_LEVELS_MAX];
+    ptrdiff_t idx = -1;
+    int const l = (memo->block == line && sim->caches[0].entries[memo->idx].tag == (U32)line)
+                ? (idx = (ptrdiff_t)memo->idx, 0)
+                : findLine(sim, line, &idx, victims);
+    U64 const arrival = arrivalFrom(sim, l, idx, cycle);
+
+    for (int m = 0; m < l; m++) sim->counters.misses[tag][m]++;
+    if (l < sim->config.nbCaches) {
+        entry_t* const entry = sim->caches[l].entries + idx;
+        entry->stamp = stamp;
+        if (entry->pending) {
+            entry->pending = 0;
+            if (entry->ready <= cycle) {
+                sim->counters.pfTimely++;
+            } else {
+                sim->counters.pfLate++;
+                sim->counters.pfLateCycles += entry->ready - cycle;
+    }   }   }
+    for (int f = 0; f < l; f++) {
+        size_t const e = fillEntry(sim, sim->caches + f, victims[f], line, stamp);
+        sim->caches[f].entries[e].ready = arrival;
+        if (f == 0) idx = (ptrdiff_t)e;
+    }
+    memo->block = line;
+    memo->idx = (size_t)idx;
+    return arrival;
+}
+
+unsigned CSIM_access(CSIM_t* sim, unsigned long long address, size_t size, int tag, unsigned long long cycle)
+{
+    U64 start = cycle, done = cycle;
+    assert((unsigned)tag < CSIM_TAGS_MAX);
+    if (size == 0) return 0;
+    {   U64 const lastPage = (address + size - 1) >> CSIM_PAGE_LOG;
+        for (U64 page = address >> CSIM_PAGE_LOG; page <= lastPage; page++) {
+            U64 const translated = cycle + translate(sim, page, tag);
+            if (translated > start) start = translated;
+    }   }
+    {   U64 const lastLine = (address + size - 1) >> CSIM_LINE_LOG;
+        for (U64 line = address >> CSIM_LINE_LOG; line <= lastLine; line++) {
+            U64 const arrival = demandLine(sim, line, tag, start);
+            sim->counters.lineAccesses[tag]++;
+            if (arrival > done) done = arrival;
+    }   }
+    return (unsigned)(done - cycle);
+}
+
+void CSIM_prefetch(CSIM_t* sim, unsigned long long address, int hintLevel, int tag, unsigned long long cycle)
+{
+    U64 const line = address >> CSIM_LINE_LOG;
+    U64 const start = cycle + translate(sim, address >> CSIM_PAGE_LOG, tag);
+    U32 const stamp = nextStamp(sim);
+    size_t victims[CSIM_LEVELS_MAX];
+    ptrdiff_t idx = -1;
+    int const l = findLine(sim, line, &idx, victims);
+    assert(hintLevel >= 0 && hintLevel < sim->config.nbCaches);
+    assert((unsigned)tag < CSIM_TAGS_MAX);
+
+    sim->counters.prefetches++;
+    if (l < sim->config.nbCaches) sim->caches[l].entries[idx].stamp = stamp;
+    if (l <= hintLevel) {
+        sim->counters.pfRedundant++;
+        return;
+    }
+    {   U64 const arrival = arrivalFrom(sim, l, idx, start);
+        for (int f = hintLevel; f < l; f++) {
+            size_t const e = fillEntry(sim, sim->caches + f, victims[f], line, stamp);
+            sim->caches[f].entries[e].ready = arrival;
+            sim->caches[f].entries[e].pending = (f == hintLevel);
+    }   }
+}
+
+unsigned long long CSIM_pendingPrefetches(const CSIM_t* sim)
+{
+    unsigned long long total = 0;
+    for (int l = 0; l < sim->config.nbCaches; l++) {
+        size_t const nbEntries = sim->caches[l].nbSets * sim->caches[l].ways;
+        for (size_t n = 0; n < nbEntries; n++) total += sim->caches[l].entries[n].pending;
+    }
+    return total;
+}
+
+const CSIM_counters_t* CSIM_counters(const CSIM_t* sim)
+{
+    return &sim->counters;
+}
+
+CSIM_config CSIM_getConfig(const CSIM_t* sim)
+{
+    return sim->config;
+}
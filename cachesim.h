@@ -0,0 +1,80 @@
+/*
+ * Cache and TLB model, to predict misses independently of the host.
+ * Each level is set-associative with LRU replacement.
+ * Levels are non-inclusive : a miss fills every level it went through,
+ * evictions are not propagated. Writes allocate like reads.
+ * Accesses carry a caller-defined tag (e.g. a stream id), counters are kept per tag.
+ *
+ * Timing : accesses are stamped with a cycle count given by the caller.
+ * A filled line becomes usable after the latency of the level it came from,
+ * so a later access to a line still in flight waits for it.
+ * Prefetches fill a hinted level, and are classified on their first demand access.
+ */
+
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <stddef.h>   /* size_t */
+
+#define CSIM_LINE_SIZE  64
+#define CSIM_PAGE_SIZE  4096
+#define CSIM_LEVELS_MAX 4
+#define CSIM_TAGS_MAX   8
+
+typedef struct {
+    size_t size;        /* caches : capacity in bytes; TLBs : nb of entries */
+    unsigned ways;      /* associativity */
+    unsigned latency;   /* cycles, on hit */
+} CSIM_levelDesc;
+
+typedef struct {
+    int nbCaches;
+    CSIM_levelDesc cache[CSIM_LEVELS_MAX];   /* L1 first */
+    unsigned memLatency;
+    int nbTlbs;
+    CSIM_levelDesc tlb[CSIM_LEVELS_MAX];     /* L1 dTLB first */
+    unsigned walkLatency;                    /* page walk, on miss of all TLBs */
+} CSIM_config;
+
+typedef struct {
+    unsigned long long lineAccesses[CSIM_TAGS_MAX];
+    unsigned long long misses[CSIM_TAGS_MAX][CSIM_LEVELS_MAX];     /* line accesses missing level l, and all levels before */
+    unsigned long long pageAccesses[CSIM_TAGS_MAX];
+    unsigned long long tlbMisses[CSIM_TAGS_MAX][CSIM_LEVELS_MAX];
+    /* prefetches, all tags */
+    unsigned long long prefetches;
+    unsigned long long pfRedundant;     /* line already in hinted level or closer */
+    unsigned long long pfTimely;        /* first demand access after arrival */
+    unsigned long long pfLate;          /* first demand access while still in flight */
+    unsigned long long pfLateCycles;    /* sum of remaining waits of late prefetches */
+    unsigned long long pfEvicted;       /* evicted from hinted level before any demand access */
+} CSIM_counters_t;
+
+typedef struct CSIM_s CSIM_t;
+
+/* a recent server core : 48 KB L1D, 2 MB L2, 32 MB LLC, 64 + 1536 entries TLBs */
+CSIM_config CSIM_defaultConfig(void);
+
+/* @return : NULL if a level is invalid (capacity not a multiple of ways x line) or allocation fails */
+CSIM_t* CSIM_create(CSIM_config config);
+void CSIM_free(CSIM_t* sim);
+
+/* empty all levels and reset counters */
+void CSIM_reset(CSIM_t* sim);
+
+/* one load or store of `size` bytes at `address`, issued at `cycle`, with `tag` < CSIM_TAGS_MAX.
+ * untimed users can leave `cycle` at 0.
+ * @return : cycles until all its bytes are available, translation included */
+unsigned CSIM_access(CSIM_t* sim, unsigned long long address, size_t size, int tag, unsigned long long cycle);
+
+/* software prefetch of the line holding `address` into cache level `hintLevel` (0 : L1) and beyond.
+ * its translation is counted under `tag`, and delays arrival, but never the caller. */
+void CSIM_prefetch(CSIM_t* sim, unsigned long long address, int hintLevel, int tag, unsigned long long cycle);
+
+/* prefetched lines still waiting for their first demand access */
+unsigned long long CSIM_pendingPrefetches(const CSIM_t* sim);
+
+const CSIM_counters_t* CSIM_counters(const CSIM_t* sim);
+CSIM_config CSIM_getConfig(const CSIM_t* sim);
+
+#endif  /* CACHESIM_H */
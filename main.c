@@ -6,6 +6,15 @@
 #include "bench.h"   // BMK_*
 #include "zfgen.h"   // generate
 #include "zfdec.h"   // decompress
+#include "zfstats.h" // analyze_frame, simulate_frame
+#include "cachesim.h" // CSIM_*
+#include "zftrace.h" // load_trace
+#include "util.h"    // UTIL_getTotalMemory, UTIL_pinThread, UTIL_mapOutputFile
+#include "perfcnt.h" // PERF_*
+#include "zfcrc.h"   // crc32c
+#include "zfformat.h" // ZF_BLOCK_LOG_*
+#include "report.h"  // REPORT_*
+#include <pthread.h>
 
 
 /* =========================== */
@@ -13,149 +22,2223 @@
 /* =========================== */
 #define DISPLAY(...)  { fprintf(stdout, __VA_ARGS__); fflush(stdout); }
 
+#define MIN(a,b)   ((a) < (b) ? (a) : (b))
+#define MAX(a,b)   ((a) > (b) ? (a) : (b))
+
+#define MT_THREADS_MAX 256
+
 static size_t zfdec(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
 {
-    (void)customPayload;
-    return decompress(dst, dstCapacity, src, srcSize);
+    (void)customPayload;
+    return decompress(dst, dstCapacity, src, srcSize);
+}
+
+static size_t zfpref(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    int const nbRounds = *(int*)customPayload;
+    return decompress_pref(dst, dstCapacity, src, srcSize, nbRounds);
+}
+
+/* content checksum : fused into decoding, or as a separate pass over decoded content */
+static size_t zfverify(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    int const nbRounds = *(int*)customPayload;
+    return decompress_verify(dst, dstCapacity, src, srcSize, nbRounds);
+}
+
+static size_t zfdeccrc(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    int const nbRounds = *(int*)customPayload;
+    size_t const warmupSize = read_header(src, srcSize).warmup_size;
+    size_t const dSize = nbRounds ? decompress_pref(dst, dstCapacity, src, srcSize, nbRounds)
+                                  : decompress(dst, dstCapacity, src, srcSize);
+    if (crc32c((const char*)dst + warmupSize, dSize) != frame_checksum(src, srcSize)) return ZF_ERROR_CHECKSUM;
+    return dSize;
+}
+
+static size_t zfgroup(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    int const groupSize = *(int*)customPayload;
+    return decompress_group(dst, dstCapacity, src, srcSize, groupSize);
+}
+
+static size_t zfreorder(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    int const windowSeqs = *(int*)customPayload;
+    return decompress_reorder(dst, dstCapacity, src, srcSize, windowSeqs);
+}
+
+/* partial decode of content bytes [from, to) */
+typedef struct {
+    size_t from;
+    size_t to;
+} range_payload;
+
+static size_t zfrange(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    range_payload const* const range = (const range_payload*)customPayload;
+    return decompress_range(dst, dstCapacity, src, srcSize, range->from, range->to);
+}
+
+/* statistics variants : @return sequence section size, so speeds measure sequences throughput */
+typedef struct {
+    frame_stats stats;
+    int nbThreads;    /* 0 : collect_stats_simd(), -1 : collect_stats() */
+} stats_payload;
+
+static size_t zfstat(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+{
+    stats_payload* const payload = (stats_payload*)customPayload;
+    frame_header const h = read_header(src, srcSize);
+    (void)dst; (void)dstCapacity;
+    payload->stats = (payload->nbThreads < 0) ? collect_stats(src, srcSize)
+                   : (payload->nbThreads == 0) ? collect_stats_simd(src, srcSize)
+                   : collect_stats_mt(src, srcSize, payload->nbThreads);
+    return h.nb_sequences * h.seq_size;
+}
+
+
+/* =========================== */
+/* ***  Hardware counters   *** */
+/* =========================== */
+
+/* enabled by -P; NULL when not requested or not available */
+static PERF_counters_t* g_counters = NULL;
+
+/* set by -C : BMK_coldFlags_e; 0 : warm, same frame decoded in loop */
+static unsigned g_coldFlags = 0;
+
+/* set by -t : time runs with invariant TSC, and report cycle costs */
+static int g_useTSC = 0;
+
+/* cycle costs of one decode, from its duration in ns */
+typedef struct {
+    double perSeq;
+    double perFarMatch;   /* 0 if frame has no far match */
+    double perByte;
+} cycle_costs;
+
+static cycle_costs cycleCosts(double nanoSec, frame_stats stats, size_t decodedSize)
+{
+    double const cycles = nanoSec * UTIL_tscFrequency() / 1000000000.;
+    cycle_costs c;
+    c.perSeq = stats.nb_sequences ? cycles / stats.nb_sequences : 0;
+    c.perFarMatch = stats.nb_far_matches ? cycles / stats.nb_far_matches : 0;
+    c.perByte = decodedSize ? cycles / decodedSize : 0;
+    return c;
+}
+
+typedef struct {
+    PERF_counters_t* counters;
+    PERF_values_t best;   /* per loop, from run with fewest cycles */
+    int hasBest;
+} perf_session;
+
+static void perf_runStart(void* payload, unsigned nbLoops)
+{
+    perf_session* const ps = (perf_session*)payload;
+    (void)nbLoops;
+    PERF_start(ps->counters);
+}
+
+static void perf_runEnd(void* payload, unsigned nbLoops)
+{
+    perf_session* const ps = (perf_session*)payload;
+    PERF_values_t v = PERF_stop(ps->counters);
+    for (int e = 0; e < PERF_NB_EVENTS; e++) v.values[e] /= nbLoops;
+    if (!ps->hasBest
+      || !v.valid[PERF_cycles]
+      || v.values[PERF_cycles] < ps->best.values[PERF_cycles]) {
+        ps->best = v;
+        ps->hasBest = 1;
+    }
+}
+
+static void perf_display(const perf_session* ps, size_t nbSeqs, size_t decodedSize)
+{
+    PERF_values_t const* const v = &ps->best;
+    if (!ps->hasBest || nbSeqs == 0 || decodedSize == 0) return;
+    for (int e = 0; e < PERF_NB_EVENTS; e++) {
+        if (!v->valid[e]) {
+            DISPLAY("    %-20s :   not available \n", PERF_eventName((PERF_event_e)e));
+            continue;
+        }
+        DISPLAY("    %-20s : %9.3f /seq  %9.4f /byte \n", PERF_eventName((PERF_event_e)e),
+                v->values[e] / nbSeqs, v->values[e] / decodedSize);
+    }
+    if (v->valid[PERF_cycles] && v->valid[PERF_instructions] && v->values[PERF_cycles] > 0)
+        DISPLAY("    %-20s : %9.3f \n", "IPC", v->values[PERF_instructions] / v->values[PERF_cycles]);
+    if (v->valid[PERF_l1dPendingMiss] && v->valid[PERF_l1dPendingMissCycles] && v->values[PERF_l1dPendingMissCycles] > 0)
+        DISPLAY("    %-20s : %9.3f \n", "memory-level-par.",
+                v->values[PERF_l1dPendingMiss] / v->values[PERF_l1dPendingMissCycles]);
+}
+
+
+typedef struct {
+    BMK_benchFn_t fn;
+    void* payload;
+    buff srcBuffer;
+    int nbSecs;
+    int nbPrefetchs;
+    const char* name;   /* variant name, for reports; NULL : not reported */
+    const char* paramName;   /* meaning of nbPrefetchs for this variant, NULL : "prefetchs" */
+    int warmup;         /* 1 : copy warm up data into dst before each run, for exact content; copy is timed */
+} benchfn_params;
+
+/* speeds of one benchmarked variant */
+typedef struct {
+    BMK_runStats_t stats;     /* ns per run */
+    double best_MBps;
+    double median_MBps;
+    double ciLow_MBps;
+    double ciHigh_MBps;
+} bench_result;
+
+/* why a difference is reported as not significant : "" when it is significant */
+static const char* noiseNote(BMK_runStats_t a, BMK_runStats_t b)
+{
+    if (BMK_isSignificant(a, b)) return "";
+    if (a.nbRuns < BMK_SIGNIFICANT_RUNS_MIN || b.nbRuns < BMK_SIGNIFICANT_RUNS_MIN) return ", too few runs";
+    return ", within noise";
+}
+
+static double toMBps(size_t nbBytes, double nanoSecPerRun)
+{
+    return nanoSecPerRun > 0 ? (double)nbBytes * 1000 / nanoSecPerRun : 0;
+}
+
+/* decoders skip warm up data, which matches may still reference : provide it in `dst` */
+static size_t prefillWarmup(void* dst, buff frame)
+{
+    frame_header const h = read_header(frame.buffer, frame.size);
+    memcpy(dst, frame_warmup(frame.buffer, h), h.warmup_size);
+    return h.warmup_size;
+}
+
+typedef struct {
+    void* dst;
+    buff frame;
+} warmup_ctx;
+
+static size_t warmupInit(void* initPayload) // type BMK_initFn_t
+{
+    warmup_ctx const* const ctx = (const warmup_ctx*)initPayload;
+    return prefillWarmup(ctx->dst, ctx->frame);
+}
+
+/* short runs : confidence intervals need many samples within the -i budget,
+ * and a median over 3 runs has an interval no narrower than their range */
+#define BENCH_RUN_MS 100
+
+static bench_result benchFunction(benchfn_params params)
+{
+    unsigned const total_ms = params.nbSecs * 1000;
+    BMK_timedFnState_t* const benchState = BMK_createTimedFnState(total_ms, BENCH_RUN_MS);
+    assert(benchState != NULL);
+    BMK_setTimedFnColdRuns(benchState, g_coldFlags);
+    BMK_setTimedFnTSC(benchState, g_useTSC);
+
+    size_t result;
+    size_t dstCapacity = decSize(params.srcBuffer.buffer, params.srcBuffer.size);
+    void* dstBuffer = malloc(dstCapacity); assert(dstBuffer != NULL);
+    warmup_ctx const warmup = { dstBuffer, params.srcBuffer };
+    const char* const paramName = params.paramName ? params.paramName : "prefetchs";
+    double bestSpeed = 0.0;
+    size_t decodedSize = 0;
+    bench_result res;
+
+    perf_session perf;
+    memset(&perf, 0, sizeof(perf));
+    if (g_counters != NULL) {
+        perf.counters = g_counters;
+        BMK_setTimedFnHooks(benchState, perf_runStart, perf_runEnd, &perf);
+    }
+
+    while (!BMK_isCompleted_TimedFn(benchState)) {
+        BMK_runOutcome_t const outcome = BMK_benchTimedFn(benchState,
+                                                    params.fn, params.payload,
+                                                    params.warmup ? warmupInit : NULL, (void*)&warmup,
+                                                    1,
+                                                    (const void* const*)&params.srcBuffer.buffer, &params.srcBuffer.size,
+                                                    &dstBuffer, &dstCapacity,
+                                                    &result);
+        BMK_runTime_t const runTime = BMK_extract_runTime(outcome);
+        //DISPLAY("nanosec per run : %llu \n", runTime.nanoSecPerRun);
+        //DISPLAY("decompressed size : %zu \n", runTime.sumOfReturn);
+
+        double const bytePerNs = (double)runTime.sumOfReturn / runTime.nanoSecPerRun;
+        double const bytePerSec = bytePerNs * 1000000000;
+        double const MBperSec = bytePerSec / 1000000;
+        if (MBperSec > bestSpeed) bestSpeed = MBperSec;
+        decodedSize = runTime.sumOfReturn;
+        DISPLAY("\r%2i %s - dec speed = %.1f MB/s    --  %i byte \r",
+                params.nbPrefetchs, paramName, bestSpeed, (int)runTime.sumOfReturn);
+    }
+
+    res.stats = BMK_getRunStats(benchState, BMK_CONFIDENCE_DEFAULT);
+    res.best_MBps = toMBps(decodedSize, res.stats.min_ns);
+    res.median_MBps = toMBps(decodedSize, res.stats.median_ns);
+    res.ciLow_MBps = toMBps(decodedSize, res.stats.ciHigh_ns);
+    res.ciHigh_MBps = toMBps(decodedSize, res.stats.ciLow_ns);
+    DISPLAY("\r%2i %s - dec speed = %.1f MB/s    --  median %.1f MB/s [%.1f - %.1f], stddev %.1f%% over %u runs \n",
+            params.nbPrefetchs, paramName, res.best_MBps, res.median_MBps, res.ciLow_MBps, res.ciHigh_MBps,
+            res.stats.mean_ns > 0 ? res.stats.stddev_ns * 100 / res.stats.mean_ns : 0,
+            res.stats.nbRuns);
+
+    if (g_counters != NULL || params.name != NULL) {
+        frame_stats const stats = collect_stats(params.srcBuffer.buffer, params.srcBuffer.size);
+        size_t const nbSeqs = stats.nb_sequences;
+        cycle_costs const costs = cycleCosts(res.stats.min_ns, stats, decodedSize);
+        if (g_counters != NULL)
+            perf_display(&perf, nbSeqs, decodedSize);
+        if (g_useTSC && params.name != NULL) {
+            DISPLAY("    %.1f cycles/seq, ", costs.perSeq);
+            if (stats.nb_far_matches) DISPLAY("%.1f cycles/far match, ", costs.perFarMatch);
+            DISPLAY("%.3f cycles/byte  (best run, TSC %.3f GHz) \n", costs.perByte, UTIL_tscFrequency() / 1e9);
+        }
+        if (params.name != NULL) {
+            REPORT_record_t record;
+            memset(&record, 0, sizeof(record));
+            record.variant = params.name;
+            record.prefetch = params.nbPrefetchs;
+            record.threads = 1;
+            record.cold = g_coldFlags;
+            record.best_MBps = res.best_MBps;
+            record.median_MBps = res.median_MBps;
+            record.ciLow_MBps = res.ciLow_MBps;
+            record.ciHigh_MBps = res.ciHigh_MBps;
+            record.nb_runs = res.stats.nbRuns;
+            record.ns_per_seq = nbSeqs ? res.stats.min_ns / nbSeqs : 0;
+            if (g_useTSC) {
+                record.cycles_per_seq = costs.perSeq;
+                record.cycles_per_far_match = costs.perFarMatch;
+                record.cycles_per_byte = costs.perByte;
+            }
+            REPORT_add(record);
+    }   }
+
+    free(dstBuffer);
+    BMK_freeTimedFnState(benchState);
+    return res;
+}
+
+static bench_result bench_variant(int prefetch_level, buff sample, int bench_nbSeconds)
+{
+    assert(prefetch_level >= 0);
+    if (prefetch_level == 0) {
+        benchfn_params params = { .fn = zfdec,
+                                  .payload = NULL,
+                                  .srcBuffer = sample,
+                                  .nbSecs = bench_nbSeconds,
+                                  .nbPrefetchs = 0,
+                                  .name = "decompress" };
+        return benchFunction(params);
+    }
+
+    // prefetch_level > 0
+    benchfn_params params = { .fn = zfpref,
+                              .payload = &prefetch_level,
+                              .srcBuffer = sample,
+                              .nbSecs = bench_nbSeconds,
+                              .nbPrefetchs = prefetch_level,
+                              .name = "decompress_pref" };
+    return benchFunction(params);
+}
+
+static bench_result bench_reorder_variant(int windowSeqs, buff sample, int bench_nbSeconds)
+{
+    benchfn_params params = { .fn = zfreorder,
+                              .payload = &windowSeqs,
+                              .srcBuffer = sample,
+                              .nbSecs = bench_nbSeconds,
+                              .nbPrefetchs = windowSeqs,   /* reported as prefetch parameter */
+                              .paramName = "seq window",
+                              .name = "decompress_reorder" };
+    return benchFunction(params);
+}
+
+static bench_result bench_group_variant(int groupSize, buff sample, int bench_nbSeconds)
+{
+    benchfn_params params = { .fn = zfgroup,
+                              .payload = &groupSize,
+                              .srcBuffer = sample,
+                              .nbSecs = bench_nbSeconds,
+                              .nbPrefetchs = groupSize,   /* reported as prefetch parameter */
+                              .paramName = "seq group",
+                              .name = "decompress_group" };
+    return benchFunction(params);
+}
+
+/* interleaved layout : decompress(), or decompress_pref() when prefetch_level > 0 */
+static bench_result bench_interleaved_variant(int prefetch_level, buff interleaved, int bench_nbSeconds)
+{
+    benchfn_params params = { .fn = prefetch_level ? zfpref : zfdec,
+                              .payload = &prefetch_level,
+                              .srcBuffer = interleaved,
+                              .nbSecs = bench_nbSeconds,
+                              .nbPrefetchs = prefetch_level,
+                              .name = prefetch_level ? "decompress_pref_interleaved" : "decompress_interleaved" };
+    return benchFunction(params);
+}
+
+/* absolute positions : decompress(), or decompress_pref() when prefetch_level > 0 */
+static bench_result bench_absolute_variant(int prefetch_level, buff absolute, int bench_nbSeconds)
+{
+    benchfn_params params = { .fn = prefetch_level ? zfpref : zfdec,
+                              .payload = &prefetch_level,
+                              .srcBuffer = absolute,
+                              .nbSecs = bench_nbSeconds,
+                              .nbPrefetchs = prefetch_level,
+                              .name = prefetch_level ? "decompress_pref_absolute" : "decompress_absolute" };
+    return benchFunction(params);
+}
+
+/* sameOutput() :
+ * decodes `sample` with decompress(), and with `fn`, both over the same warm up data.
+ * @return : 1 if decoded content is identical */
+static int sameOutput(buff sample, BMK_benchFn_t fn, void* payload)
+{
+    size_t const dstCapacity = decSize(sample.buffer, sample.size);
+    size_t const warmupSize = read_header(sample.buffer, sample.size).warmup_size;
+    char* const ref = malloc(dstCapacity); assert(ref != NULL);
+    char* const out = malloc(dstCapacity); assert(out != NULL);
+    prefillWarmup(ref, sample);
+    prefillWarmup(out, sample);
+    size_t const refSize = decompress(ref, dstCapacity, sample.buffer, sample.size);
+    size_t const outSize = fn(sample.buffer, sample.size, out, dstCapacity, payload);
+    int const same = (refSize == outSize) && !memcmp(ref + warmupSize, out + warmupSize, refSize);
+    free(out);
+    free(ref);
+    return same;
+}
+
+static int bench_once(buff sample, int prefetch_level, int bench_nbSeconds)
+{
+    assert(prefetch_level >= 0);
+    bench_variant(prefetch_level, sample, bench_nbSeconds);
+    return 0;
+}
+
+/* bench_all() :
+ * sweep prefetch depths, then tell which depth is fastest,
+ * and which ones can't be told apart from it with current measurement noise */
+#define PREFETCH_LEVELS 50
+static int bench_all(buff sample, int bench_nbSeconds)
+{
+    bench_result results[PREFETCH_LEVELS];
+    int best = 0;
+    for (int i = 0; i < PREFETCH_LEVELS; i++) {
+        results[i] = bench_variant(i, sample, bench_nbSeconds);
+        if (results[i].median_MBps > results[best].median_MBps) {
+            if (!BMK_isSignificant(results[i].stats, results[best].stats))
+                DISPLAY("   (faster than %i prefetchs, but not significant%s) \n", best,
+                        noiseNote(results[i].stats, results[best].stats));
+            best = i;
+        }
+    }
+
+    DISPLAY("best : %i prefetchs, median %.1f MB/s \n", best, results[best].median_MBps);
+    DISPLAY("not significantly slower :");
+    for (int i = 0; i < PREFETCH_LEVELS; i++)
+        if (i != best && !BMK_isSignificant(results[i].stats, results[best].stats))
+            DISPLAY(" %i", i);
+    DISPLAY(" \n");
+    return 0;
+}
+
+/* =========================== */
+/* ***  Prefetch auto-tune   *** */
+/* =========================== */
+
+/* coarse-to-fine search of the best prefetch depth :
+ * short runs of TUNE_RUN_MS on a logarithmic grid,
+ * then interval halving around the best depth.
+ * depths which can't be told apart from the best one
+ * receive more runs, up to TUNE_RUNS_MAX */
+#define TUNE_DEPTH_MAX  64
+#define TUNE_RUN_MS    100
+#define TUNE_RUNS_MIN    3
+#define TUNE_RUNS_MAX   15
+static const int tune_grid[] = { 0, 1, 2, 4, 8, 16, 32, 48, 64 };
+#define TUNE_GRID_SIZE (int)(sizeof(tune_grid) / sizeof(tune_grid[0]))
+
+typedef struct {
+    buff sample;
+    void* dst;
+    size_t dstCapacity;
+    size_t decodedSize;
+    unsigned nbRuns;
+    int depths[TUNE_DEPTH_MAX + 1];   /* zfpref payloads */
+    BMK_timedFnState_t* states[TUNE_DEPTH_MAX + 1];   /* NULL : not measured */
+} tune_ctx;
+
+static BMK_runStats_t tune_stats(const tune_ctx* t, int d)
+{
+    return BMK_getRunStats(t->states[d], BMK_CONFIDENCE_DEFAULT);
+}
+
+/* measure depth `d` until it has at least `nbRuns` runs */
+static void tune_measure(tune_ctx* t, int d, unsigned nbRuns)
+{
+    assert(0 <= d && d <= TUNE_DEPTH_MAX);
+    if (t->states[d] == NULL) {
+        t->states[d] = BMK_createTimedFnState(TUNE_RUNS_MAX * TUNE_RUN_MS, TUNE_RUN_MS);
+        assert(t->states[d] != NULL);
+        BMK_setTimedFnColdRuns(t->states[d], g_coldFlags);
+        BMK_setTimedFnTSC(t->states[d], g_useTSC);
+        t->depths[d] = d;
+    }
+    while (tune_stats(t, d).nbRuns < nbRuns) {
+        BMK_runOutcome_t const outcome = BMK_benchTimedFn(t->states[d],
+                                                    d ? zfpref : zfdec, &t->depths[d],
+                                                    NULL, NULL,
+                                                    1,
+                                                    (const void* const*)&t->sample.buffer, &t->sample.size,
+                                                    &t->dst, &t->dstCapacity,
+                                                    NULL);
+        assert(BMK_isSuccessful_runOutcome(outcome));
+        t->decodedSize = BMK_extract_runTime(outcome).sumOfReturn;
+        t->nbRuns++;
+    }
+}
+
+static int tune_best(const tune_ctx* t)
+{
+    int best = -1;
+    for (int d = 0; d <= TUNE_DEPTH_MAX; d++) {
+        if (t->states[d] == NULL) continue;
+        if (best < 0 || tune_stats(t, d).median_ns < tune_stats(t, best).median_ns) best = d;
+    }
+    return best;
+}
+
+/* add runs to the best depth and its ties, until they separate, or reach TUNE_RUNS_MAX */
+static int tune_resolve(tune_ctx* t)
+{
+    for (unsigned nbRuns = TUNE_RUNS_MIN + 1; nbRuns <= TUNE_RUNS_MAX; nbRuns++) {
+        int const best = tune_best(t);
+        BMK_runStats_t const bestStats = tune_stats(t, best);
+        int nbTies = 0;
+        for (int d = 0; d <= TUNE_DEPTH_MAX; d++) {
+            if (d == best || t->states[d] == NULL) continue;
+            if (BMK_isSignificant(tune_stats(t, d), bestStats)) continue;
+            tune_measure(t, d, nbRuns);
+            nbTies++;
+        }
+        if (nbTies == 0) break;
+        tune_measure(t, best, nbRuns);
+    }
+    return tune_best(t);
+}
+
+static double tune_MBps(const tune_ctx* t, double ns)
+{
+    return ns > 0 ? (double)t->decodedSize * 1000 / ns : 0;
+}
+
+static int bench_tune(buff sample)
+{
+    UTIL_time_t const start = UTIL_getTime();
+    tune_ctx t;
+    memset(&t, 0, sizeof(t));
+    t.sample = sample;
+    t.dstCapacity = decSize(sample.buffer, sample.size);
+    t.dst = malloc(t.dstCapacity); assert(t.dst != NULL);
+
+    /* coarse grid */
+    for (int g = 0; g < TUNE_GRID_SIZE; g++) {
+        tune_measure(&t, tune_grid[g], TUNE_RUNS_MIN);
+        DISPLAY("\r%2i prefetchs : %.1f MB/s        ", tune_grid[g],
+                tune_MBps(&t, tune_stats(&t, tune_grid[g]).median_ns));
+    }
+    int best = tune_resolve(&t);
+
+    /* refine between grid neighbours of best depth */
+    {   int lo = best, hi = best;
+        for (int g = 0; g < TUNE_GRID_SIZE; g++) {
+            if (tune_grid[g] < best) lo = tune_grid[g];
+            if (tune_grid[g] > best) { hi = tune_grid[g]; break; }
+        }
+        while (hi - lo > 2) {
+            int const a = (lo + best) / 2;
+            int const b = (best + hi + 1) / 2;
+            int newBest;
+            if (a != lo && a != best) tune_measure(&t, a, TUNE_RUNS_MIN);
+            if (b != hi && b != best) tune_measure(&t, b, TUNE_RUNS_MIN);
+            DISPLAY("\rrefining between %i and %i prefetchs        ", lo, hi);
+            newBest = tune_resolve(&t);
+            if (newBest < lo || newBest > hi) { best = newBest; break; }   /* earlier candidate won after more runs */
+            if (newBest < best) hi = best;
+            else if (newBest > best) lo = best;
+            else if (a == lo && b == hi) break;
+            else lo = a, hi = b;
+            best = newBest;
+        }
+        best = tune_best(&t);
+    }
+    DISPLAY("\r%60s\r", "");
+
+    {   BMK_runStats_t const bestStats = tune_stats(&t, best);
+        int nbTested = 0, nbTies = 0;
+        double worstTie = 0;
+        DISPLAY("tested depths :");
+        for (int d = 0; d <= TUNE_DEPTH_MAX; d++) {
+            if (t.states[d] == NULL) continue;
+            nbTested++;
+            DISPLAY(" %i", d);
+        }
+        DISPLAY(" \n");
+        DISPLAY("recommended prefetch depth : %i  (%s), median %.1f MB/s [%.1f - %.1f] \n",
+                best, best ? "decompress_pref" : "decompress",
+                tune_MBps(&t, bestStats.median_ns),
+                tune_MBps(&t, bestStats.ciHigh_ns), tune_MBps(&t, bestStats.ciLow_ns));
+        DISPLAY("within noise of best :");
+        for (int d = 0; d <= TUNE_DEPTH_MAX; d++) {
+            if (d == best || t.states[d] == NULL) continue;
+            {   BMK_runStats_t const st = tune_stats(&t, d);
+                if (BMK_isSignificant(st, bestStats)) continue;
+                worstTie = MAX(worstTie, 1 - bestStats.median_ns / st.median_ns);
+                DISPLAY(" %i", d);
+                nbTies++;
+        }   }
+        DISPLAY("%s \n", nbTies ? "" : " none");
+        if (nbTies == 0) {
+            DISPLAY("confidence : high, significantly faster than the %i other tested depths \n", nbTested - 1);
+        } else {
+            DISPLAY("confidence : %s, %i of %i tested depths are statistically tied, up to %.1f%% slower \n",
+                    worstTie < 0.02 ? "medium" : "low", nbTies, nbTested - 1, worstTie * 100);
+        }
+        DISPLAY("search time : %.1f s, %u runs \n", (double)UTIL_clockSpanMicro(start) / 1000000, t.nbRuns);
+
+        {   REPORT_record_t record;
+            memset(&record, 0, sizeof(record));
+            record.variant = best ? "decompress_pref" : "decompress";
+            record.prefetch = best;
+            record.threads = 1;
+            record.cold = g_coldFlags;
+            record.best_MBps = tune_MBps(&t, bestStats.min_ns);
+            record.median_MBps = tune_MBps(&t, bestStats.median_ns);
+            record.ciLow_MBps = tune_MBps(&t, bestStats.ciHigh_ns);
+            record.ciHigh_MBps = tune_MBps(&t, bestStats.ciLow_ns);
+            record.nb_runs = bestStats.nbRuns;
+            REPORT_add(record);
+    }   }
+
+    for (int d = 0; d <= TUNE_DEPTH_MAX; d++) BMK_freeTimedFnState(t.states[d]);
+    free(t.dst);
+    return 0;
+}
+
+/* log of block or checkpoint interval, 0 when there is none */
+static unsigned intervalLog(size_t nbSeqs)
+{
+    unsigned log = 0;
+    while (((size_t)1 << log) < nbSeqs) log++;
+    return log;
+}
+
+/* describeFrame() :
+ * fields of `desc` read from frame header : which frame a record was measured on */
+static void describeFrame(REPORT_sample_t* desc, buff frame)
+{
+    frame_header const h = read_header(frame.buffer, frame.size);
+    desc->warmup_size = h.warmup_size;
+    desc->format_version = h.version;
+    desc->flags = h.flags;
+    desc->block_log = intervalLog(h.block_seqs);
+    desc->checkpoint_log = intervalLog(h.checkpoint_seqs);
+    desc->nb_sequences = h.nb_sequences;
+    desc->original_size = h.original_size;
+}
+
+/* describeConversion() :
+ * `frame`, converted from current sample, is the one measured by subsequent reports */
+static void describeConversion(buff frame)
+{
+    REPORT_sample_t desc = REPORT_getSample();
+    describeFrame(&desc, frame);
+    REPORT_setSample(desc);
+}
+
+/* generate_sample() :
+ * generate frame with offset mix `mixId`,
+ * and describe it for subsequent reports */
+static buff generate_sample(gen_params gparams, int mixId)
+{
+    buff const sample = generate(gen_mix(gparams, mixId));
+    REPORT_sample_t desc;
+    desc.source = "generated";
+    desc.mix = gen_mixName(mixId);
+    desc.offset_min = gparams.offset_min;
+    desc.offset_max = gparams.offset_max;
+    describeFrame(&desc, sample);
+    REPORT_setSample(desc);
+    return sample;
+}
+
+static buff load_sample(const char* traceName)
+{
+    buff const sample = load_trace(traceName);
+    if (sample.buffer != NULL) {
+        frame_stats const stats = collect_stats(sample.buffer, sample.size);
+        REPORT_sample_t desc;
+        desc.source = traceName;
+        desc.mix = "trace";
+        desc.offset_min = stats.offset_min;
+        desc.offset_max = stats.offset_max;
+        describeFrame(&desc, sample);
+        REPORT_setSample(desc);
+    }
+    return sample;
+}
+
+
+/* =========================== */
+/* ***   Multi-core scaling  *** */
+/* =========================== */
+
+/* Each worker decodes its own frame, pinned onto its own core,
+ * while all other workers do the same, sharing memory bandwidth.
+ * Workers start together, and all stop as soon as the first one has decoded for nbSecs :
+ * decodes completing after that ran under less contention, they are not counted. */
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int nbWaiting;
+    int nbThreads;
+    int generation;
+    int stop;          /* set once the first worker's time budget is spent */
+} mt_barrier;
+
+static void mt_barrier_init(mt_barrier* b, int nbThreads)
+{
+    pthread_mutex_init(&b->mutex, NULL);
+    pthread_cond_init(&b->cond, NULL);
+    b->nbWaiting = 0;
+    b->nbThreads = nbThreads;
+    b->generation = 0;
+    b->stop = 0;
+}
+
+static void mt_barrier_destroy(mt_barrier* b)
+{
+    pthread_cond_destroy(&b->cond);
+    pthread_mutex_destroy(&b->mutex);
+}
+
+/* releases waiting threads when the last one arrives, under mutex */
+static void mt_barrier_check(mt_barrier* b)
+{
+    if (b->nbWaiting > 0 && b->nbWaiting == b->nbThreads) {
+        b->nbWaiting = 0;
+        b->generation++;
+        pthread_cond_broadcast(&b->cond);
+    }
+}
+
+static void mt_barrier_wait(mt_barrier* b)
+{
+    pthread_mutex_lock(&b->mutex);
+    {   int const generation = b->generation;
+        b->nbWaiting++;
+        mt_barrier_check(b);
+        while (generation == b->generation)
+            pthread_cond_wait(&b->cond, &b->mutex);
+    }
+    pthread_mutex_unlock(&b->mutex);
+}
+
+/* a thread which could not start no longer counts as a participant */
+static void mt_barrier_leave(mt_barrier* b)
+{
+    pthread_mutex_lock(&b->mutex);
+    b->nbThreads--;
+    mt_barrier_check(b);
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static void mt_stop(mt_barrier* b)
+{
+    pthread_mutex_lock(&b->mutex);
+    b->stop = 1;
+    pthread_mutex_unlock(&b->mutex);
+}
+
+static int mt_stopped(mt_barrier* b)
+{
+    int stop;
+    pthread_mutex_lock(&b->mutex);
+    stop = b->stop;
+    pthread_mutex_unlock(&b->mutex);
+    return stop;
+}
+
+typedef struct {
+    buff frame;
+    void* dst;
+    size_t dstCapacity;
+    int cpu;
+    int prefetch_level;
+    unsigned nbSecs;
+    mt_barrier* barrier;
+    int pinned;    /* result : 1 if running on its own core */
+    double MBps;   /* result */
+} mt_worker;
+
+static void* mt_decode(void* arg)
+{
+    mt_worker* const w = (mt_worker*)arg;
+    BMK_benchFn_t const fn = w->prefetch_level ? zfpref : zfdec;
+    U64 const budget_ns = (U64)w->nbSecs * 1000000000ULL;
+    U64 totalTime_ns = 0;
+    size_t totalBytes = 0;
+
+    w->pinned = (w->cpu >= 0) && !UTIL_pinThread(w->cpu);
+    /* start all decoders together, once all are pinned */
+    mt_barrier_wait(w->barrier);
+    while (!mt_stopped(w->barrier)) {
+        UTIL_time_t const start = UTIL_getTime();
+        size_t const decoded = fn(w->frame.buffer, w->frame.size, w->dst, w->dstCapacity, &w->prefetch_level);
+        U64 const span_ns = UTIL_clockSpanNano(start);
+        /* completed while some workers were already stopped : not under full load */
+        if (mt_stopped(w->barrier)) break;
+        totalBytes += decoded;
+        totalTime_ns += span_ns;
+        if (totalTime_ns >= budget_ns) mt_stop(w->barrier);
+    }
+
+    w->MBps = totalTime_ns ? (double)totalBytes / (double)totalTime_ns * 1000 : 0.;
+    return NULL;
+}
+
+/* run nbThreads concurrent decoders, each at prefetch_level.
+ * threads which can't be created are left out, and reported.
+ * @return : aggregated MB/s */
+static double bench_threads(mt_worker* workers, int nbThreads, int prefetch_level, unsigned nbSecs)
+{
+    pthread_t threads[MT_THREADS_MAX];
+    int created[MT_THREADS_MAX];
+    mt_barrier barrier;
+    double aggregate = 0, slowest = 0, fastest = 0;
+    int nbRunning = 0, nbUnpinned = 0, nbEmpty = 0;
+    mt_barrier_init(&barrier, nbThreads);
+    for (int t = 0; t < nbThreads; t++) {
+        workers[t].prefetch_level = prefetch_level;
+        workers[t].nbSecs = nbSecs;
+        workers[t].barrier = &barrier;
+        created[t] = !pthread_create(&threads[t], NULL, mt_decode, &workers[t]);
+        if (!created[t]) mt_barrier_leave(&barrier);
+    }
+    for (int t = 0; t < nbThreads; t++) {
+        if (!created[t]) continue;
+        pthread_join(threads[t], NULL);
+        aggregate += workers[t].MBps;
+        if (nbRunning==0 || workers[t].MBps < slowest) slowest = workers[t].MBps;
+        if (nbRunning==0 || workers[t].MBps > fastest) fastest = workers[t].MBps;
+        nbRunning++;
+        nbUnpinned += !workers[t].pinned;
+        nbEmpty += (workers[t].MBps == 0);
+    }
+    mt_barrier_destroy(&barrier);
+    if (nbRunning < nbThreads)
+        DISPLAY("warning : only %i of %i threads could start \n", nbRunning, nbThreads);
+    if (nbRunning == 0) return 0;
+    if (nbUnpinned)
+        DISPLAY("warning : %i of %i threads not pinned onto their own core \n", nbUnpinned, nbRunning);
+    if (nbEmpty)
+        DISPLAY("warning : %i threads completed no decode before the first one stopped, increase -i \n", nbEmpty);
+    DISPLAY("%3i threads, %2i prefetchs : %8.1f MB/s aggregate, per thread : %7.1f avg, %7.1f min, %7.1f max \n",
+            nbRunning, prefetch_level, aggregate, aggregate / nbRunning, slowest, fastest);
+    {   REPORT_record_t record;
+        memset(&record, 0, sizeof(record));
+        record.variant = prefetch_level ? "decompress_pref" : "decompress";
+        record.prefetch = prefetch_level;
+        record.threads = nbRunning;
+        record.unpinned = nbUnpinned;
+        record.cold = 0;
+        record.best_MBps = aggregate;
+        record.median_MBps = aggregate;
+        record.ciLow_MBps = aggregate;
+        record.ciHigh_MBps = aggregate;
+        record.nb_runs = 1;
+        {   frame_header const h = read_header(workers[0].frame.buffer, workers[0].frame.size);
+            double const seqBytes = (double)(h.original_size - h.warmup_size) / h.nb_sequences;
+            record.ns_per_seq = aggregate > 0 ? seqBytes / (aggregate / nbRunning) * 1000 : 0;   /* per thread */
+        }
+        REPORT_add(record);
+    }
+    return aggregate;
+}
+
+/* bench_scaling() :
+ * sweep nb of concurrent decoders, from 1 to nb of physical cores,
+ * then up to nb of hardware threads, for each prefetch level.
+ * if nbThreadsSet > 0, only this nb of threads is measured. */
+static int bench_scaling(gen_params gparams, int mixId, int nbThreadsSet, int prefetch_level, unsigned nbSecs)
+{
+    int const nbPhysical = UTIL_countPhysicalCores();
+    int const nbLogical = UTIL_countLogicalCores();
+    int cpus[MT_THREADS_MAX];
+    int const nbCpus = UTIL_getCoresOrder(cpus, MT_THREADS_MAX);
+    int const nbThreadsMax = MIN(nbThreadsSet ? nbThreadsSet : MAX(nbLogical, nbPhysical), MT_THREADS_MAX);
+    int const levelMin = prefetch_level >= 0 ? prefetch_level : 0;
+    int const levelMax = prefetch_level >= 0 ? prefetch_level : 49;
+    int nbCounts = 0;
+    int threadCounts[MT_THREADS_MAX];
+
+    DISPLAY("%i physical cores, %i hardware threads \n", nbPhysical, nbLogical);
+
+    /* thread counts : powers of 2, plus physical and logical core counts */
+    for (int n = 1; n <= nbThreadsMax; n++) {
+        if (nbThreadsSet && n != nbThreadsSet) continue;
+        if ((n & (n-1)) == 0 || n == nbPhysical || n == nbThreadsMax) threadCounts[nbCounts++] = n;
+    }
+
+    assert(nbThreadsMax > 0);
+    mt_worker* const workers = calloc((size_t)nbThreadsMax, sizeof(mt_worker));
+    assert(workers != NULL);
+    {   U64 const totalMem = UTIL_getTotalMemory();
+        for (int t = 0; t < nbThreadsMax; t++) {
+            workers[t].frame = generate_sample(gparams, mixId);
+            workers[t].dstCapacity = decSize(workers[t].frame.buffer, workers[t].frame.size);
+            workers[t].dst = malloc(workers[t].dstCapacity);
+            assert(workers[t].dst != NULL);
+            memset(workers[t].dst, 0xE5, workers[t].dstCapacity);
+            workers[t].cpu = (t < nbCpus) ? cpus[t] : -1;
+            if (totalMem && (U64)(t+1) * (workers[t].frame.size + workers[t].dstCapacity) > totalMem / 4 * 3)
+                DISPLAY("warning : frames of %i threads occupy most of physical memory \n", t+1);
+    }   }
+
+    for (int c = 0; c < nbCounts; c++) {
+        int const nbThreads = threadCounts[c];
+        int bestLevel = 0;
+        double bestSpeed = 0;
+        DISPLAY("\n=== %i concurrent decoders === \n", nbThreads);
+        for (int level = levelMin; level <= levelMax; level++) {
+            double const speed = bench_threads(workers, nbThreads, level, nbSecs);
+            if (speed > bestSpeed) bestSpeed = speed, bestLevel = level;
+        }
+        DISPLAY("best with %i threads : %i prefetchs, %.1f MB/s aggregate \n", nbThreads, bestLevel, bestSpeed);
+    }
+
+    for (int t = 0; t < nbThreadsMax; t++) {
+        free_buff(workers[t].frame);
+        free(workers[t].dst);
+    }
+    free(workers);
+    return 0;
+}
+
+/* windowFits() :
+ * a frame generated with history `window` holds it as warm up data,
+ * and its output buffer holds it again, plus up to 256 MB of sequences, literals and content.
+ * @return : 1 if this fits into physical memory, or if its size is unknown */
+static int windowFits(U64 totalMem, size_t window)
+{
+    return !totalMem || 2 * (U64)window + (256 << 20) <= totalMem;
+}
+
+/* bench_windows() :
+ * large windows, from 2 to 16 GB, beyond 32-bit frame limits.
+ * this is where TLB and DRAM behaviour change the most.
+ * windows which do not fit into physical memory are skipped */
+#define GB *(1ULL << 30)
+static int bench_windows(int mixId, int prefetch_level, int bench_nbSeconds)
+{
+    U64 const totalMem = UTIL_getTotalMemory();
+    for (size_t window = 2 GB; window <= 16 GB; window *= 2) {
+        DISPLAY("\n=== window %u GB === \n", (unsigned)(window >> 30));
+        if (!windowFits(totalMem, window)) {
+            DISPLAY("skipped : not enough memory (%u MB available) \n", (unsigned)(totalMem >> 20));
+            continue;
+        }
+        {   buff const sample = generate_sample(gen_window(init_gen_params(), window), mixId);
+            if (prefetch_level >= 0)
+                bench_once(sample, prefetch_level, bench_nbSeconds);
+            else
+                bench_all(sample, bench_nbSeconds);
+            free_buff(sample);
+    }   }
+    return 0;
+}
+
+/* bench_heatmap() :
+ * window size x prefetch depth matrix of median speeds,
+ * from L2-resident offsets up to multi-GB windows,
+ * to locate crossover points of each CPU generation.
+ * windows which do not fit into physical memory are skipped */
+#define HM_NB_WINDOWS 8
+#define HM_NB_DEPTHS 10
+static const int hm_depths[HM_NB_DEPTHS] = { 0, 1, 2, 4, 8, 12, 16, 24, 32, 48 };
+
+static void displaySize(size_t size)
+{
+    if (size >= 1 GB) DISPLAY("%4u GB", (unsigned)(size >> 30))
+    else if (size >= (1 << 20)) DISPLAY("%4u MB", (unsigned)(size >> 20))
+    else if (size >= (1 << 10)) DISPLAY("%4u KB", (unsigned)(size >> 10))
+    else DISPLAY("%4u B ", (unsigned)size)
+}
+
+static int bench_heatmap(int mixId, int bench_nbSeconds)
+{
+    U64 const totalMem = UTIL_getTotalMemory();
+    bench_result results[HM_NB_WINDOWS][HM_NB_DEPTHS];
+    int skipped[HM_NB_WINDOWS];
+    size_t windows[HM_NB_WINDOWS];
+
+    for (int w = 0; w < HM_NB_WINDOWS; w++) {
+        size_t const window = (size_t)256 << 10 << (2 * w);   /* 256 KB, x4 each step, up to 4 GB */
+        windows[w] = window;
+        DISPLAY("\n=== window "); displaySize(window); DISPLAY(" === \n");
+        skipped[w] = !windowFits(totalMem, window);
+        if (skipped[w]) {
+            DISPLAY("skipped : not enough memory (%u MB available) \n", (unsigned)(totalMem >> 20));
+            continue;
+        }
+        {   buff const sample = generate_sample(gen_window(init_gen_params(), window), mixId);
+            for (int d = 0; d < HM_NB_DEPTHS; d++)
+                results[w][d] = bench_variant(hm_depths[d], sample, bench_nbSeconds);
+            free_buff(sample);
+    }   }
+
+    DISPLAY("\nmedian MB/s, offset mix %s \n", gen_mixName(mixId));
+    DISPLAY(" window ");
+    for (int d = 0; d < HM_NB_DEPTHS; d++) DISPLAY(" %6i", hm_depths[d]);
+    DISPLAY("   best  (ties within noise) \n");
+    for (int w = 0; w < HM_NB_WINDOWS; w++) {
+        int best = 0;
+        if (skipped[w]) continue;
+        displaySize(windows[w]); DISPLAY(" ");
+        for (int d = 0; d < HM_NB_DEPTHS; d++) {
+            DISPLAY(" %6.0f", results[w][d].median_MBps);
+            if (results[w][d].median_MBps > results[w][best].median_MBps) best = d;
+        }
+        DISPLAY("   %4i  (", hm_depths[best]);
+        for (int d = 0; d < HM_NB_DEPTHS; d++)
+            if (d != best && !BMK_isSignificant(results[w][d].stats, results[w][best].stats))
+                DISPLAY(" %i", hm_depths[d]);
+        DISPLAY(" ) \n");
+    }
+    return 0;
+}
+
+/* ============================== */
+/* ***  Regression gate        *** */
+/* ============================== */
+
+/* bench_compare() :
+ * rerun each variant of a baseline CSV report, on a frame generated with same parameters
+ * (or replaying same trace), and compare median speeds.
+ * A variant regresses when it is slower by more than `threshold` percent,
+ * and confidence intervals of both medians are disjoint.
+ * Variants whose frame can't be reproduced identically (same layout and flags, nb of sequences and size)
+ * are not compared, and fail the gate too, like variants --compare doesn't know how to replay.
+ * Scaling and small-frame records are skipped.
+ * @return : nb of regressions, plus variants not reproducible or not covered */
+#define COMPARE_THRESHOLD_DEFAULT 3.0
+
+static int mixIdFromName(const char* name)
+{
+    for (int mixId = 0; mixId < GEN_NB_MIXES; mixId++)
+        if (!strcmp(gen_mixName(mixId), name)) return mixId;
+    return -1;
+}
+
+/* fields read from frame header, see describeFrame() */
+static int sameFrame(const REPORT_sample_t* a, const REPORT_sample_t* b)
+{
+    return a->warmup_size == b->warmup_size
+        && a->format_version == b->format_version
+        && a->flags == b->flags
+        && a->block_log == b->block_log
+        && a->checkpoint_log == b->checkpoint_log
+        && a->nb_sequences == b->nb_sequences
+        && a->original_size == b->original_size;
+}
+
+static int sameSample(const REPORT_entry_t* a, const REPORT_entry_t* b)
+{
+    return !strcmp(a->source, b->source)
+        && !strcmp(a->mix, b->mix)
+        && a->sample.offset_max == b->sample.offset_max
+        && sameFrame(&a->sample, &b->sample);
+}
+
+/* records measured on a single frame can be replayed;
+ * scaling ones are aggregated over threads, and latency ones over a pool of frames */
+static int replayable(const REPORT_entry_t* e)
+{
+    return e->record.threads == 1 && strcmp(e->source, "small-frames");
+}
+
+/* flags set at generation; the others come from layout conversions, see compare_layout().
+ * absolute positions of indexed frames can only be generated :
+ * otherwise, absolute_frame() and generation give the same frame */
+#define COMPARE_GEN_FLAGS (ZF_FLAG_CHECKSUM | ZF_FLAG_LONG_MATCHES | ZF_FLAG_INDEX)
+#define COMPARE_ABSOLUTE_GENERATED(flags) (((flags) & ZF_FLAG_ABSOLUTE) && ((flags) & ZF_FLAG_INDEX))
+
+/* same generated frame, or same trace, before layout conversions */
+static int sameBase(const REPORT_entry_t* a, const REPORT_entry_t* b)
+{
+    return !strcmp(a->source, b->source)
+        && !strcmp(a->mix, b->mix)
+        && a->sample.offset_max == b->sample.offset_max
+        && (a->sample.flags & COMPARE_GEN_FLAGS) == (b->sample.flags & COMPARE_GEN_FLAGS)
+        && COMPARE_ABSOLUTE_GENERATED(a->sample.flags) == COMPARE_ABSOLUTE_GENERATED(b->sample.flags)
+        && a->sample.checkpoint_log == b->sample.checkpoint_log;
+}
+
+/* compare_base() :
+ * frame generated with same parameters, or trace replayed, before layout conversions.
+ * @return : .buffer == NULL if it can't be reproduced */
+static buff compare_base(const REPORT_entry_t* e)
+{
+    buff const none = { NULL, 0 };
+    if (strcmp(e->source, "generated")) return load_sample(e->source);   /* trace */
+    {   int const mixId = mixIdFromName(e->mix);
+        gen_params gparams = init_gen_params();
+        if (mixId < 0) return none;
+        if (e->sample.offset_max != gparams.offset_max) gparams = gen_window(gparams, e->sample.offset_max);
+        gparams.checksum = (e->sample.flags & ZF_FLAG_CHECKSUM) != 0;
+        gparams.long_matches = (e->sample.flags & ZF_FLAG_LONG_MATCHES) != 0;
+        gparams.absolute = COMPARE_ABSOLUTE_GENERATED(e->sample.flags) != 0;
+        gparams.checkpoint_log = (e->sample.flags & ZF_FLAG_INDEX) ? (int)e->sample.checkpoint_log : 0;
+        return generate_sample(gparams, mixId);
+    }
+}
+
+/* compare_layout() :
+ * converts `base` like benchmark modes did, see bench_interleave() and bench_absolute().
+ * @return : `base` itself when there is nothing to convert, .buffer == NULL on invalid layout */
+static buff compare_layout(buff base, const REPORT_entry_t* e)
+{
+    buff const none = { NULL, 0 };
+    frame_header const h = read_header(base.buffer, base.size);
+    int const interleaved = (e->sample.flags & ZF_FLAG_INTERLEAVED) != 0;
+    int const absolute = (e->sample.flags & ZF_FLAG_ABSOLUTE) && !(h.flags & ZF_FLAG_ABSOLUTE);
+    buff converted = base;
+    if (interleaved && (e->sample.block_log < ZF_BLOCK_LOG_MIN || e->sample.block_log > ZF_BLOCK_LOG_MAX)) return none;
+    if ((interleaved || absolute) && (h.flags & ZF_FLAG_INDEX)) return none;
+    if (!interleaved && !absolute && h.version >= e->sample.format_version) return base;
+    if (absolute) converted = absolute_frame(base);
+    if (interleaved || !absolute) {
+        buff const single = converted;
+        converted = interleave_frame(single, interleaved ? (int)e->sample.block_log : 0);
+        if (single.buffer != base.buffer) free_buff(single);
+    }
+    describeConversion(converted);
+    return converted;
+}
+
+static int bench_compare(const char* baselineName, double threshold, int bench_nbSeconds)
+{
+    REPORT_entry_t* entries = NULL;
+    int const nbEntries = REPORT_loadCSV(baselineName, &entries);
+    if (nbEntries < 0) {
+        DISPLAY("cannot read baseline %s \n", baselineName);
+        return 1;
+    }
+    if (nbEntries == 0) {
+        DISPLAY("baseline %s is empty \n", baselineName);
+        free(entries);
+        return 1;
+    }
+    DISPLAY("baseline : %i records, from host %s, %s, %s \n",
+            nbEntries, entries[0].host, entries[0].cpu, entries[0].compiler);
+    if (strcmp(entries[0].compiler, REPORT_compiler()))
+        DISPLAY("current compiler : %s \n", REPORT_compiler());
+
+    bench_result* const results = calloc(nbEntries, sizeof(bench_result)); assert(results != NULL);
+    enum { cmp_skipped = 0, cmp_measured, cmp_notReproducible, cmp_notCovered };
+    int* const status = calloc(nbEntries, sizeof(int)); assert(status != NULL);
+    buff base = { NULL, 0 }, sample = { NULL, 0 };   /* sample may be base itself */
+    const REPORT_entry_t* baseEntry = NULL;
+    const REPORT_entry_t* sampleEntry = NULL;
+    for (int n = 0; n < nbEntries; n++) {
+        const REPORT_entry_t* const e = &entries[n];
+        if (!replayable(e)) continue;
+        if (sampleEntry == NULL || !sameSample(sampleEntry, e)) {
+            if (sample.buffer != base.buffer) free_buff(sample);
+            sample.buffer = NULL; sample.size = 0;
+            /* layouts of a frame are converted from a single generation, like benchmark modes do */
+            if (baseEntry == NULL || !sameBase(baseEntry, e)) {
+                free_buff(base);
+                base = compare_base(e);
+                baseEntry = e;
+            }
+            if (base.buffer != NULL) sample = compare_layout(base, e);
+            sampleEntry = e;
+            /* speeds of different frames can't be compared */
+            if (sample.buffer != NULL) {
+                REPORT_sample_t regenerated;
+                describeFrame(&regenerated, sample);
+                if (!sameFrame(&regenerated, &e->sample)) {
+                    DISPLAY("frame differs from baseline (format %u, flags %u, %zu sequences, %zu bytes, instead of %u, %u, %zu, %zu) \n",
+                            regenerated.format_version, regenerated.flags, regenerated.nb_sequences, regenerated.original_size,
+                            e->sample.format_version, e->sample.flags, e->sample.nb_sequences, e->sample.original_size);
+                    if (sample.buffer != base.buffer) free_buff(sample);
+                    sample.buffer = NULL; sample.size = 0;
+        }   }   }
+        if (sample.buffer == NULL) { status[n] = cmp_notReproducible; continue; }
+        g_coldFlags = e->record.cold;
+        if (!strcmp(e->variant, "decompress_reorder")) {
+            results[n] = bench_reorder_variant(e->record.prefetch, sample, bench_nbSeconds);
+        } else if (!strcmp(e->variant, "decompress_group")) {
+            results[n] = bench_group_variant(e->record.prefetch, sample, bench_nbSeconds);
+        } else if (!strcmp(e->variant, "decompress") || !strcmp(e->variant, "decompress_pref")) {
+            results[n] = bench_variant(e->record.prefetch, sample, bench_nbSeconds);
+        } else if (!strcmp(e->variant, "decompress_interleaved") || !strcmp(e->variant, "decompress_pref_interleaved")) {
+            results[n] = bench_interleaved_variant(e->record.prefetch, sample, bench_nbSeconds);
+        } else if (!strcmp(e->variant, "decompress_absolute") || !strcmp(e->variant, "decompress_pref_absolute")) {
+            results[n] = bench_absolute_variant(e->record.prefetch, sample, bench_nbSeconds);
+        } else {
+            status[n] = cmp_notCovered;   /* checksums, range decoding : no replay yet */
+            continue;
+        }
+        status[n] = cmp_measured;
+    }
+    if (sample.buffer != base.buffer) free_buff(sample);
+    free_buff(base);
+
+    int nbRegressions = 0, nbCompared = 0, nbNotReproducible = 0, nbNotCovered = 0;
+    DISPLAY("\n%-27s %4s  %-12s %7s %4s  %9s  %9s  %7s  %s \n",
+            "variant", "pref", "mix", "window", "cold", "base MB/s", "new MB/s", "delta", "status");
+    for (int n = 0; n < nbEntries; n++) {
+        const REPORT_entry_t* const e = &entries[n];
+        REPORT_record_t const* const base = &e->record;
+        DISPLAY("%-27s %4i  %-12s ", base->variant, base->prefetch,
+                strcmp(e->source, "generated") ? e->source : e->mix);
+        displaySize(e->sample.offset_max);
+        DISPLAY(" %4u  %9.1f  ", base->cold, base->median_MBps);
+        if (status[n] == cmp_notReproducible) {
+            DISPLAY("%9s  %7s  NOT REPRODUCIBLE \n", "-", "-");
+            nbNotReproducible++;
+            continue;
+        }
+        if (status[n] == cmp_notCovered) {
+            DISPLAY("%9s  %7s  NOT COVERED \n", "-", "-");
+            nbNotCovered++;
+            continue;
+        }
+        if (status[n] != cmp_measured) {
+            DISPLAY("%9s  %7s  skipped \n", "-", "-");
+            continue;
+        }
+        {   bench_result const* const r = &results[n];
+            double const delta = (r->median_MBps - base->median_MBps) * 100 / base->median_MBps;
+            /* without intervals on both sides, only threshold applies */
+            int const significant = (base->nb_runs < BMK_SIGNIFICANT_RUNS_MIN || r->stats.nbRuns < BMK_SIGNIFICANT_RUNS_MIN)
+                                  || r->ciHigh_MBps < base->ciLow_MBps
+                                  || r->ciLow_MBps > base->ciHigh_MBps;
+            const char* status = "ok";
+            if (delta < -threshold) status = significant ? "REGRESSION" : "slower, within noise";
+            if (delta > threshold) status = significant ? "faster" : "faster, within noise";
+            nbRegressions += (delta < -threshold && significant);
+            nbCompared++;
+            DISPLAY("%9.1f  %+6.1f%%  %s \n", r->median_MBps, delta, status);
+    }   }
+    DISPLAY("%i variants compared, %i regressions beyond %.1f%% \n", nbCompared, nbRegressions, threshold);
+    if (nbNotReproducible)
+        DISPLAY("%i variants not compared : their frame could not be reproduced \n", nbNotReproducible);
+    if (nbNotCovered)
+        DISPLAY("%i variants not compared : --compare can't replay them \n", nbNotCovered);
+
+    free(status);
+    free(results);
+    free(entries);
+    return nbRegressions + nbNotReproducible + nbNotCovered;
+}
+
+/* bench_mixes() :
+ * run the same benchmark on each preset offset mix.
+ * uniform far offsets are the worst case for the decoder,
+ * realistic mixes tell how much of the prefetching gain remains */
+static int bench_mixes(int prefetch_level, int bench_nbSeconds)
+{
+    for (int mixId = 0; mixId < GEN_NB_MIXES; mixId++) {
+        DISPLAY("\n=== offset mix %i : %s === \n", mixId, gen_mixName(mixId));
+        buff const sample = generate_sample(init_gen_params(), mixId);
+        if (prefetch_level >= 0)
+            bench_once(sample, prefetch_level, bench_nbSeconds);
+        else
+            bench_all(sample, bench_nbSeconds);
+        free_buff(sample);
+    }
+    return 0;
+}
+
+/* ============================= */
+/* ***  Small-frame latency   *** */
+/* ============================= */
+
+/* pool of small frames, from 64 KB to 4 MB,
+ * decoded one at a time, in a different random order each round.
+ * all frames reference a history window of `windowSize`, provided as warm up */
+#define LAT_NB_CLASSES        4
+#define LAT_FRAMES_PER_CLASS 16
+#define LAT_WINDOW_DEFAULT   (4 << 20)
+static const size_t lat_frameSizes[LAT_NB_CLASSES] = { 64 << 10, 256 << 10, 1 << 20, 4 << 20 };
+
+typedef struct {
+    double* values;   /* ns per decode */
+    size_t nb;
+    size_t capacity;
+} lat_samples;
+
+static void lat_add(lat_samples* ls, double value)
+{
+    if (ls->nb == ls->capacity) {
+        ls->capacity = ls->capacity ? ls->capacity * 2 : 1024;
+        ls->values = realloc(ls->values, ls->capacity * sizeof(double)); assert(ls->values != NULL);
+    }
+    ls->values[ls->nb++] = value;
+}
+
+static size_t lat_decode(buff frame, void* dst, size_t dstCapacity, int prefetch_level)
+{
+    if (prefetch_level == 0)
+        return decompress(dst, dstCapacity, frame.buffer, frame.size);
+    return decompress_pref(dst, dstCapacity, frame.buffer, frame.size, prefetch_level);
+}
+
+static void lat_report(const char* mixName, gen_params gparams, buff frame,
+                       int prefetch_level, const lat_samples* ls,
+                       double p50, double p90, double p99, double p999)
+{
+    frame_header const h = read_header(frame.buffer, frame.size);
+    double const frameSize = (double)(h.original_size - h.warmup_size);   /* representative of its class */
+    REPORT_sample_t desc;
+    REPORT_record_t record;
+    desc.source = "small-frames";
+    desc.mix = mixName;
+    desc.offset_min = gparams.offset_min;
+    desc.offset_max = gparams.offset_max;
+    describeFrame(&desc, frame);
+    REPORT_setSample(desc);
+
+    memset(&record, 0, sizeof(record));
+    record.variant = prefetch_level ? "decompress_pref" : "decompress";
+    record.prefetch = prefetch_level;
+    record.threads = 1;
+    record.cold = g_coldFlags;
+    record.best_MBps = frameSize * 1000 / ls->values[0];
+    record.median_MBps = frameSize * 1000 / p50;
+    record.ciLow_MBps = record.median_MBps;
+    record.ciHigh_MBps = record.median_MBps;
+    record.nb_runs = (unsigned)ls->nb;
+    record.ns_per_seq = p50 / h.nb_sequences;
+    record.p50_us = p50 / 1000;
+    record.p90_us = p90 / 1000;
+    record.p99_us = p99 / 1000;
+    record.p999_us = p999 / 1000;
+    REPORT_add(record);
+}
+
+static int bench_latency(int mixId, size_t windowSize, int prefetch_level, unsigned nbSecs)
+{
+    static const int defaultLevels[] = { 0, 1, 2, 4, 8, 16, 32 };
+    int const nbLevels = prefetch_level >= 0 ? 1 : (int)(sizeof(defaultLevels) / sizeof(defaultLevels[0]));
+    int const nbFrames = LAT_NB_CLASSES * LAT_FRAMES_PER_CLASS;
+    buff frames[LAT_NB_CLASSES * LAT_FRAMES_PER_CLASS];
+    int order[LAT_NB_CLASSES * LAT_FRAMES_PER_CLASS];
+    lat_samples samples[LAT_NB_CLASSES];
+    gen_params classParams[LAT_NB_CLASSES];
+    size_t dstCapacity = 0;
+    unsigned seed = 2531011;
+
+    if (windowSize == 0) windowSize = LAT_WINDOW_DEFAULT;
+    DISPLAY("generating %i frames, from %u KB to %u KB, window %u KB \n",
+            nbFrames, (unsigned)(lat_frameSizes[0] >> 10),
+            (unsigned)(lat_frameSizes[LAT_NB_CLASSES-1] >> 10), (unsigned)(windowSize >> 10));
+    for (int f = 0; f < nbFrames; f++) {
+        int const c = f / LAT_FRAMES_PER_CLASS;
+        classParams[c] = gen_mix(gen_smallFrame(init_gen_params(), lat_frameSizes[c], windowSize), mixId);
+        classParams[c].silent = 1;
+        frames[f] = generate(classParams[c]);
+        dstCapacity = MAX(dstCapacity, decSize(frames[f].buffer, frames[f].size));
+        order[f] = f;
+    }
+    void* const dst = malloc(dstCapacity); assert(dst != NULL);
+    memset(dst, 0xE5, dstCapacity);
+    memset(samples, 0, sizeof(samples));
+
+    for (int l = 0; l < nbLevels; l++) {
+        int const level = prefetch_level >= 0 ? prefetch_level : defaultLevels[l];
+        for (int c = 0; c < LAT_NB_CLASSES; c++) samples[c].nb = 0;
+
+        /* warm up : one untimed decode per frame */
+        for (int f = 0; f < nbFrames; f++) lat_decode(frames[f], dst, dstCapacity, level);
+
+        {   UTIL_time_t const start = UTIL_getTime();
+            while (UTIL_clockSpanMicro(start) < (U64)nbSecs * 1000000) {
+                for (int f = nbFrames - 1; f > 0; f--) {   /* shuffle */
+                    int const r = (int)(BMK_rand(&seed) % (unsigned)(f + 1));
+                    int const tmp = order[f]; order[f] = order[r]; order[r] = tmp;
+                }
+                for (int n = 0; n < nbFrames; n++) {
+                    buff const frame = frames[order[n]];
+                    if (g_coldFlags) {
+                        UTIL_flushCache(frame.buffer, frame.size);
+                        UTIL_flushCache(dst, decSize(frame.buffer, frame.size));
+                        if (g_coldFlags & BMK_cold_tlb) UTIL_evictTLB();
+                    }
+                    {   UTIL_time_t const t0 = UTIL_getTime();
+                        U64 const tsc0 = g_useTSC ? UTIL_readTSC() : 0;
+                        lat_decode(frame, dst, dstCapacity, level);
+                        lat_add(&samples[order[n] / LAT_FRAMES_PER_CLASS],
+                                g_useTSC ? (double)UTIL_tscSpanNano(tsc0, UTIL_readTSC())
+                                         : (double)UTIL_clockSpanNano(t0));
+        }   }   }   }
+
+        DISPLAY("%2i prefetchs \n", level);
+        for (int c = 0; c < LAT_NB_CLASSES; c++) {
+            lat_samples* const ls = &samples[c];
+            BMK_sortDoubles(ls->values, ls->nb);
+            double const p50 = BMK_percentile(ls->values, ls->nb, 0.50);
+            double const p90 = BMK_percentile(ls->values, ls->nb, 0.90);
+            double const p99 = BMK_percentile(ls->values, ls->nb, 0.99);
+            double const p999 = BMK_percentile(ls->values, ls->nb, 0.999);
+            DISPLAY("    %5u KB frames : p50 %9.1f us   p90 %9.1f us   p99 %9.1f us   p99.9 %9.1f us  (%zu decodes) \n",
+                    (unsigned)(lat_frameSizes[c] >> 10), p50 / 1000, p90 / 1000, p99 / 1000, p999 / 1000, ls->nb);
+            lat_report(gen_mixName(mixId), classParams[c], frames[c * LAT_FRAMES_PER_CLASS],
+                       level, ls, p50, p90, p99, p999);
+        }
+        if (samples[0].nb < 1000 || samples[LAT_NB_CLASSES-1].nb < 1000)
+            DISPLAY("    note : less than 1000 decodes per size, p99.9 is the maximum; increase -i \n");
+    }
+
+    for (int c = 0; c < LAT_NB_CLASSES; c++) free(samples[c].values);
+    for (int f = 0; f < nbFrames; f++) free_buff(frames[f]);
+    free(dst);
+    return 0;
+}
+
+/* log-binned histogram, one line per non-empty bin */
+static void display_histogram(const char* title, const size_t* hist, size_t total, int asSize)
+{
+    DISPLAY("%s : \n", title);
+    for (int b = 0; b < ANALYSIS_LOG_BINS; b++) {
+        if (hist[b] == 0) continue;
+        if (b == 0) {
+            DISPLAY("  %17s", "0");
+        } else if (asSize) {
+            DISPLAY("  ["); displaySize((size_t)1 << (b-1));
+            DISPLAY(" - "); displaySize((size_t)1 << b); DISPLAY(")");
+        } else {
+            DISPLAY("  [%6llu - %6llu)", 1ULL << (b-1), 1ULL << b);
+        }
+        DISPLAY(" : %9zu  %5.1f%% \n", hist[b], (double)hist[b] * 100 / total);
+    }
+}
+
+static void visualize_analysis(frame_analysis fa)
+{
+    static const struct { const char* name; size_t size; } caches[] = {
+        { "32 KB", 32 << 10 }, { "1 MB", 1 << 20 }, { "32 MB", 32 << 20 } };
+    size_t const nbSeqs = fa.basic.nb_sequences;
+    size_t const nbMatches = fa.nb_matches ? fa.nb_matches : 1;
+
+    display_histogram("literal lengths", fa.ll_hist, nbSeqs, 0);
+    display_histogram("match lengths", fa.ml_hist, nbSeqs, 0);
+    display_histogram("offsets", fa.offset_hist, nbMatches, 1);
+
+    DISPLAY("match sources crossing a cache line : %5.1f%% \n", (double)fa.line_crossings * 100 / nbMatches);
+    DISPLAY("match sources crossing a page       : %5.2f%% \n", (double)fa.page_crossings * 100 / nbMatches);
+
+    /* LRU hit rates, from reuse distances */
+    DISPLAY("match source lines : %zu, first touched within frame : %.1f%% \n",
+            fa.nb_source_lines, (double)fa.reuse_cold * 100 / (fa.nb_source_lines ? fa.nb_source_lines : 1));
+    for (size_t c = 0; c < sizeof(caches) / sizeof(caches[0]); c++) {
+        size_t const nbLines = caches[c].size / ANALYSIS_LINE_SIZE;
+        size_t hits = 0;
+        for (int b = 0; b < ANALYSIS_LOG_BINS && ((size_t)1 << b) <= nbLines; b++) hits += fa.reuse_hist[b];
+        DISPLAY("  reuse distance < %6zu lines : %5.1f%%  (LRU hits in %s) \n",
+                nbLines, (double)hits * 100 / (fa.nb_source_lines ? fa.nb_source_lines : 1), caches[c].name);
+    }
+
+    DISPLAY("distinct pages touched per %u sequences : %.0f (%.1f MB) %s \n",
+            ANALYSIS_PAGES_BLOCK, fa.pages_per_block, fa.pages_per_block * ANALYSIS_PAGE_SIZE / (1 << 20),
+            fa.nb_page_blocks ? "" : "(whole frame, shorter than one block)");
+}
+
+/* speeds in MB/s of sequence section */
+static frame_stats bench_stats(buff sample, int nbThreads)
+{
+    stats_payload payload;
+    benchfn_params params = { .fn = zfstat,
+                              .payload = &payload,
+                              .srcBuffer = sample,
+                              .nbSecs = 1,
+                              .nbPrefetchs = 0,
+                              .name = NULL };
+    payload.nbThreads = nbThreads;
+    if (nbThreads < 0) {
+        DISPLAY("collect_stats, scalar : \n");
+    } else if (nbThreads == 0) {
+        DISPLAY("collect_stats, simd : \n");
+    } else {
+        DISPLAY("collect_stats, simd, %i threads : \n", nbThreads);
+    }
+    benchFunction(params);
+    return payload.stats;
+}
+
+static int visualize_stats(buff sample)
+{
+    frame_stats const stats = bench_stats(sample, -1);
+    {   int const nbThreads = MIN(UTIL_countLogicalCores(), STATS_THREADS_MAX);
+        frame_stats const simd = bench_stats(sample, 0);
+        frame_stats const mt = bench_stats(sample, nbThreads > 1 ? nbThreads : 2);
+        /* frame_stats is made of size_t only : no padding */
+        if (memcmp(&simd, &stats, sizeof(stats)) || memcmp(&mt, &stats, sizeof(stats))) {
+            DISPLAY("error : statistics variants disagree \n");
+            return 1;
+    }   }
+
+    unsigned const nb_sequences = (unsigned)stats.nb_sequences;
+    DISPLAY("frame format : v%u \n", read_header(sample.buffer, sample.size).version);
+    DISPLAY("nb sequences : %5u \n", nb_sequences);
+    size_t const total_sequence_length = stats.original_size  - stats.literal_leftover;
+    double const average_sequence_length = (double)total_sequence_length / nb_sequences;
+    DISPLAY("average sequences length : %5.1f \n", average_sequence_length);
+    double const average_match_length = (double)stats.total_match_lengths / nb_sequences;
+    DISPLAY("average match length : %5.1f \n", average_match_length);
+    double const average_literal_length = (double)stats.total_literal_lengths / nb_sequences;
+    DISPLAY("average literal length : %5.1f \n", average_literal_length);
+    DISPLAY("minimum offset : %6zu \n", stats.offset_min);
+    DISPLAY("maximum offset : %6zu \n", stats.offset_max);
+    DISPLAY("far matches (offset >= %u KB) : %zu (%.1f%%) \n", STATS_FAR_OFFSET >> 10,
+            stats.nb_far_matches, (double)stats.nb_far_matches * 100 / nb_sequences);
+
+    visualize_analysis(analyze_frame(sample.buffer, sample.size));
+    return 0;
+}
+
+
+/* Cache model : predicted misses per level, independent of the host */
+static void display_levels(const char* title, const CSIM_levelDesc* levels, int nbLevels, int isTlb)
+{
+    DISPLAY("%s :", title);
+    for (int l = 0; l < nbLevels; l++) {
+        if (isTlb) {
+            DISPLAY(" %zu entries %u-way %u cy%s", levels[l].size, levels[l].ways, levels[l].latency, l+1 < nbLevels ? "," : "");
+        } else {
+            DISPLAY(" "); displaySize(levels[l].size);
+            DISPLAY(" %u-way %u cy%s", levels[l].ways, levels[l].latency, l+1 < nbLevels ? "," : "");
+        }
+    }
+    DISPLAY(" \n");
+}
+
+static int bench_simulate(buff sample, CSIM_config config)
+{
+    CSIM_t* const sim = CSIM_create(config);
+    if (sim == NULL) {
+        DISPLAY("invalid cache model \n");
+        return 1;
+    }
+    display_levels("caches", config.cache, config.nbCaches, 0);
+    display_levels("TLBs (4 KB pages)", config.tlb, config.nbTlbs, 1);
+    DISPLAY("memory : %u cy, page walk : %u cy \n", config.memLatency, config.walkLatency);
+
+    UTIL_time_t const start = UTIL_getTime();
+    simulate_frame(sim, sample.buffer, sample.size);
+    double const elapsed_s = (double)UTIL_clockSpanMicro(start) / 1000000;
+
+    const CSIM_counters_t* const c = CSIM_counters(sim);
+    size_t const nbSeqs = read_header(sample.buffer, sample.size).nb_sequences;
+    double const perSeq = 1. / (nbSeqs ? nbSeqs : 1);
+    unsigned long long totalLines = 0;
+    unsigned long long totalMisses[CSIM_LEVELS_MAX] = { 0 };
+    unsigned long long totalTlbMisses[CSIM_LEVELS_MAX] = { 0 };
+
+    DISPLAY("%-10s %11s", "stream", "lines");
+    for (int l = 0; l < config.nbCaches; l++) DISPLAY("  %8s%i miss", "L", l+1);
+    for (int l = 0; l < config.nbTlbs; l++) DISPLAY("  %6s%i miss", "TLB", l+1);
+    DISPLAY(" \n");
+    for (int s = 0; s < SIM_NB_STREAMS; s++) {
+        DISPLAY("%-10s %11llu", simulate_streamName((sim_stream_e)s), c->lineAccesses[s]);
+        totalLines += c->lineAccesses[s];
+        for (int l = 0; l < config.nbCaches; l++) {
+            DISPLAY("  %14llu", c->misses[s][l]);
+            totalMisses[l] += c->misses[s][l];
+        }
+        for (int l = 0; l < config.nbTlbs; l++) {
+            DISPLAY("  %12llu", c->tlbMisses[s][l]);
+            totalTlbMisses[l] += c->tlbMisses[s][l];
+        }
+        DISPLAY(" \n");
+    }
+    DISPLAY("%-10s %11llu", "total", totalLines);
+    for (int l = 0; l < config.nbCaches; l++) DISPLAY("  %14llu", totalMisses[l]);
+    for (int l = 0; l < config.nbTlbs; l++) DISPLAY("  %12llu", totalTlbMisses[l]);
+    DISPLAY(" \n");
+    DISPLAY("%-10s %11.2f", "per seq", (double)totalLines * perSeq);
+    for (int l = 0; l < config.nbCaches; l++) DISPLAY("  %14.3f", (double)totalMisses[l] * perSeq);
+    for (int l = 0; l < config.nbTlbs; l++) DISPLAY("  %12.3f", (double)totalTlbMisses[l] * perSeq);
+    DISPLAY(" \n");
+    DISPLAY("simulated %zu sequences in %.2f s \n", nbSeqs, elapsed_s);
+
+    CSIM_free(sim);
+    return 0;
+}
+
+/* Prefetch policies, on the cache model's timing :
+ * no depth given : depth x hint level, with decompress_pref() lines;
+ * fixed depth (-b#) : lines per match x hint level.
+ * Policies are independent, each thread evaluates them on its own model */
+#define EVAL_NB_LINES 4
+#define EVAL_POLICIES_MAX (HM_NB_DEPTHS * EVAL_NB_LINES * CSIM_LEVELS_MAX + 1)
+static const int eval_lines[EVAL_NB_LINES] = { PREFETCH_LINES_WILDCOPY, 1, 2, 4 };
+
+typedef struct {
+    buff sample;
+    CSIM_config config;
+    const prefetch_policy* policies;
+    policy_eval* results;
+    int nbPolicies;
+    int next;          /* next policy to evaluate, under mutex */
+    int failed;
+    pthread_mutex_t mutex;
+} eval_pool;
+
+static void* eval_worker(void* arg)
+{
+    eval_pool* const pool = (eval_pool*)arg;
+    CSIM_t* const sim = CSIM_create(pool->config);
+    for (;;) {
+        int p;
+        pthread_mutex_lock(&pool->mutex);
+        p = pool->next++;
+        if (sim == NULL) pool->failed = 1;
+        pthread_mutex_unlock(&pool->mutex);
+        if (sim == NULL || p >= pool->nbPolicies) break;
+        pool->results[p] = evaluate_policy(sim, pool->sample.buffer, pool->sample.size, pool->policies[p]);
+    }
+    CSIM_free(sim);
+    return NULL;
+}
+
+static double percentOf(unsigned long long part, unsigned long long total)
+{
+    return total ? (double)part * 100 / total : 0.;
 }
 
-static size_t zfpref(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+static int bench_policies(buff sample, int prefetch_level, CSIM_config config)
 {
-    int const nbRounds = *(int*)customPayload;
-    return decompress_pref(dst, dstCapacity, src, srcSize, nbRounds);
+    prefetch_policy policies[EVAL_POLICIES_MAX];
+    policy_eval results[EVAL_POLICIES_MAX];
+    int nbPolicies = 0;
+    int const nbDepths = (prefetch_level >= 0) ? 1 : HM_NB_DEPTHS;
+    int const nbLines = (prefetch_level >= 0) ? EVAL_NB_LINES : 1;
+    size_t const nbSeqs = read_header(sample.buffer, sample.size).nb_sequences;
+    double const perSeq = 1. / (nbSeqs ? nbSeqs : 1);
+
+    {   CSIM_t* const sim = CSIM_create(config);
+        if (sim == NULL) {
+            DISPLAY("invalid cache model \n");
+            return 1;
+        }
+        CSIM_free(sim);
+    }
+    display_levels("caches", config.cache, config.nbCaches, 0);
+    display_levels("TLBs (4 KB pages)", config.tlb, config.nbTlbs, 1);
+    DISPLAY("memory : %u cy, page walk : %u cy \n", config.memLatency, config.walkLatency);
+
+    /* first policy : no prefetch, reference */
+    policies[nbPolicies].depth = 0;
+    policies[nbPolicies].nbLines = PREFETCH_LINES_WILDCOPY;
+    policies[nbPolicies].hintLevel = 0;
+    nbPolicies++;
+    for (int d = 0; d < nbDepths; d++) {
+        int const depth = (prefetch_level >= 0) ? prefetch_level : hm_depths[d];
+        if (depth == 0) continue;
+        for (int n = 0; n < nbLines; n++) {
+            for (int hint = 0; hint < config.nbCaches; hint++) {
+                assert(nbPolicies < EVAL_POLICIES_MAX);
+                policies[nbPolicies].depth = depth;
+                policies[nbPolicies].nbLines = eval_lines[n];
+                policies[nbPolicies].hintLevel = hint;
+                nbPolicies++;
+    }   }   }
+
+    UTIL_time_t const start = UTIL_getTime();
+    int const nbThreads = MIN(MIN(UTIL_countLogicalCores(), MT_THREADS_MAX), nbPolicies);
+    int nbRunning = 1;
+    {   pthread_t threads[MT_THREADS_MAX];
+        int created[MT_THREADS_MAX];
+        eval_pool pool;
+        pool.sample = sample;
+        pool.config = config;
+        pool.policies = policies;
+        pool.results = results;
+        pool.nbPolicies = nbPolicies;
+        pool.next = 0;
+        pool.failed = 0;
+        pthread_mutex_init(&pool.mutex, NULL);
+        /* calling thread is the first worker; a thread which can't start leaves its policies to the others */
+        for (int t = 0; t < nbThreads; t++)
+            created[t] = (t > 0) && !pthread_create(&threads[t], NULL, eval_worker, &pool);
+        eval_worker(&pool);
+        for (int t = 0; t < nbThreads; t++)
+            if (created[t]) { pthread_join(threads[t], NULL); nbRunning++; }
+        pthread_mutex_destroy(&pool.mutex);
+        if (pool.failed) {
+            DISPLAY("not enough memory for cache models \n");
+            return 1;
+    }   }
+    double const elapsed_s = (double)UTIL_clockSpanMicro(start) / 1000000;
+
+    policy_eval const* const base = &results[0];
+    DISPLAY("no prefetch : %.1f cycles/seq, %.1f stall cycles/seq (model) \n",
+            (double)base->cycles * perSeq, (double)base->stall_cycles * perSeq);
+    DISPLAY("depth  lines  hint  cycles/seq  speedup  prefetches/seq  timely    late  redundant  evicted  unused  late wait \n");
+    for (int p = 1; p < nbPolicies; p++) {
+        prefetch_policy const policy = policies[p];
+        policy_eval const* const pe = &results[p];
+        CSIM_counters_t const* const c = &pe->counters;
+        if (policy.nbLines == PREFETCH_LINES_WILDCOPY) {
+            DISPLAY("%5i  %5s", policy.depth, "wild");
+        } else {
+            DISPLAY("%5i  %5i", policy.depth, policy.nbLines);
+        }
+        DISPLAY("   L%i  %10.1f  %6.2fx  %14.2f  %5.1f%%  %5.1f%%     %5.1f%%   %5.1f%%  %5.1f%%  %9.1f \n",
+                policy.hintLevel + 1, (double)pe->cycles * perSeq, (double)base->cycles / (pe->cycles ? pe->cycles : 1),
+                (double)c->prefetches * perSeq,
+                percentOf(c->pfTimely, c->prefetches), percentOf(c->pfLate, c->prefetches),
+                percentOf(c->pfRedundant, c->prefetches), percentOf(c->pfEvicted, c->prefetches),
+                percentOf(pe->pf_unused, c->prefetches),
+                c->pfLate ? (double)c->pfLateCycles / c->pfLate : 0.);
+    }
+    DISPLAY("evaluated %i policies in %.1f s on %i threads (%.0f per minute) \n",
+            nbPolicies, elapsed_s, nbRunning, elapsed_s > 0 ? nbPolicies * 60 / elapsed_s : 0.);
+    return 0;
 }
 
-static size_t zfstat(const void* src, size_t srcSize, void* dst, size_t dstCapacity, void* customPayload) // type BMK_benchFn_t;
+/* =========================== */
+/* ***   Content checksum    *** */
+/* =========================== */
+
+/* bench_verify() :
+ * cost of checking content, fused into decoding, versus a separate pass once decoding is complete.
+ * frame is checked first, then again after a corrupted literal, which must be detected */
+static int bench_verify(buff sample, int prefetch_level, int bench_nbSeconds)
 {
-    (void)dst; (void)dstCapacity;
-    frame_stats const stats = collect_stats(src, srcSize);
-    memcpy(customPayload, &stats, sizeof(stats));
+    int nbRounds = prefetch_level > 0 ? prefetch_level : 0;
+    {   size_t const dstCapacity = decSize(sample.buffer, sample.size);
+        frame_header const h = read_header(sample.buffer, sample.size);
+        char* const dst = malloc(dstCapacity); assert(dst != NULL);
+        int error = 0;
+        if (!h.checksum_size) {
+            DISPLAY("error : frame has no checksum \n");
+            free(dst);
+            return 1;
+        }
+        prefillWarmup(dst, sample);
+        if (decompress_verify(dst, dstCapacity, sample.buffer, sample.size, nbRounds) != h.original_size - h.warmup_size) {
+            DISPLAY("error : checksum mismatch on valid frame \n");
+            error = 1;
+        }
+        {   char* const lastLiteral = (char*)sample.buffer + sample.size - h.checksum_size - h.extension_size - 1;
+            *lastLiteral ^= 1;
+            if (decompress_verify(dst, dstCapacity, sample.buffer, sample.size, nbRounds) != ZF_ERROR_CHECKSUM) {
+                DISPLAY("error : corrupted frame not detected \n");
+                error = 1;
+            }
+            *lastLiteral ^= 1;
+        }
+        free(dst);
+        if (error) return 1;
+        DISPLAY("checksum %08X verified, corruption detected \n", frame_checksum(sample.buffer, sample.size));
+    }
+
+    /* all variants restore warm up data before each run, so that checksums match */
+    DISPLAY("decode only : \n");
+    bench_result const plain = benchFunction((benchfn_params){ .fn = nbRounds ? zfpref : zfdec,
+                                                               .payload = &nbRounds,
+                                                               .srcBuffer = sample,
+                                                               .nbSecs = bench_nbSeconds,
+                                                               .nbPrefetchs = nbRounds,
+                                                               .name = nbRounds ? "decompress_pref" : "decompress",
+                                                               .warmup = 1 });
+    DISPLAY("decode + fused checksum, every %u bytes : \n", ZF_VERIFY_CHUNK);
+    bench_result const fused = benchFunction((benchfn_params){ .fn = zfverify,
+                                                               .payload = &nbRounds,
+                                                               .srcBuffer = sample,
+                                                               .nbSecs = bench_nbSeconds,
+                                                               .nbPrefetchs = nbRounds,
+                                                               .name = "decompress_verify",
+                                                               .warmup = 1 });
+    DISPLAY("decode, then checksum pass : \n");
+    bench_result const separate = benchFunction((benchfn_params){ .fn = zfdeccrc,
+                                                                  .payload = &nbRounds,
+                                                                  .srcBuffer = sample,
+                                                                  .nbSecs = bench_nbSeconds,
+                                                                  .nbPrefetchs = nbRounds,
+                                                                  .name = "decompress+crc32c",
+                                                                  .warmup = 1 });
+
+    /* overhead : extra time per byte, relative to decode only */
+    DISPLAY("checksum overhead (median) : fused %+.1f%%, separate pass %+.1f%% \n",
+            fused.median_MBps > 0 ? (plain.median_MBps / fused.median_MBps - 1) * 100 : 0.,
+            separate.median_MBps > 0 ? (plain.median_MBps / separate.median_MBps - 1) * 100 : 0.);
+    if (!BMK_isSignificant(fused.stats, separate.stats))
+        DISPLAY("fused and separate checksum can't be told apart%s \n", noiseNote(fused.stats, separate.stats));
     return 0;
 }
 
+/* =========================== */
+/* ***  Reordered decoding   *** */
+/* =========================== */
 
-typedef struct {
-    BMK_benchFn_t fn;
-    void* payload;
-    buff srcBuffer;
-    int nbSecs;
-    int nbPrefetchs;
-} benchfn_params;
+#define REORDER_NB_WINDOWS 5
+static const int reorder_windows[REORDER_NB_WINDOWS] = { 64, 256, 1024, 2048, 4096 };
 
-static int benchFunction(benchfn_params params)
+/* bench_reorder() :
+ * decompress() as reference, then decompress_reorder() with window `windowSeqs`,
+ * or with each window of reorder_windows[] when `windowSeqs` is 0.
+ * each window is checked for exact output first */
+static int bench_reorder(buff sample, int windowSeqs, int bench_nbSeconds)
 {
-    unsigned const total_ms = params.nbSecs * 1000;
-    unsigned const run_ms = 1000;
-    BMK_timedFnState_t* const benchState = BMK_createTimedFnState(total_ms, run_ms);
-    assert(benchState != NULL);
+    int const nbWindows = windowSeqs ? 1 : REORDER_NB_WINDOWS;
+    DISPLAY("decompress, reference : \n");
+    bench_result const ref = bench_variant(0, sample, bench_nbSeconds);
 
-    size_t result;
-    size_t dstCapacity = decSize(params.srcBuffer.buffer, params.srcBuffer.size);
-    void* dstBuffer = malloc(dstCapacity); assert(dstBuffer != NULL);
-    double bestSpeed = 0.0;
+    for (int w = 0; w < nbWindows; w++) {
+        int window = windowSeqs ? windowSeqs : reorder_windows[w];
+        reorder_analysis const ra = analyze_reorder(sample.buffer, sample.size, window);
+        DISPLAY("window of %i sequences : %.1f%% of matches final, %.2f final matches per source page \n",
+                window, ra.nb_matches ? (double)ra.nb_final * 100 / ra.nb_matches : 0.,
+                ra.nb_final_pages ? (double)ra.nb_final / ra.nb_final_pages : 0.);
+        if (!sameOutput(sample, zfreorder, &window)) {
+            DISPLAY("error : decompress_reorder() output differs from decompress() \n");
+            return 1;
+        }
+        {   bench_result const r = bench_reorder_variant(window, sample, bench_nbSeconds);
+            DISPLAY("  vs decompress : %+.1f%% (median)%s \n",
+                    ref.median_MBps > 0 ? (r.median_MBps - ref.median_MBps) * 100 / ref.median_MBps : 0.,
+                    noiseNote(r.stats, ref.stats));
+    }   }
+    return 0;
+}
 
-    while (!BMK_isCompleted_TimedFn(benchState)) {
-        BMK_runOutcome_t const outcome = BMK_benchTimedFn(benchState,
-                                                    params.fn, params.payload,
-                                                    NULL, NULL,
-                                                    1,
-                                                    (const void* const*)&params.srcBuffer.buffer, &params.srcBuffer.size,
-                                                    &dstBuffer, &dstCapacity,
-                                                    &result);
-        BMK_runTime_t const runTime = BMK_extract_runTime(outcome);
-        //DISPLAY("nanosec per run : %llu \n", runTime.nanoSecPerRun);
-        //DISPLAY("decompressed size : %zu \n", runTime.sumOfReturn);
+/* =========================== */
+/* ***  Interleaved layout   *** */
+/* =========================== */
 
-        double const bytePerNs = (double)runTime.sumOfReturn / runTime.nanoSecPerRun;
-        double const bytePerSec = bytePerNs * 1000000000;
-        double const MBperSec = bytePerSec / 1000000;
-        if (MBperSec > bestSpeed) bestSpeed = MBperSec;
-        DISPLAY("\r%2i prefetchs - dec speed = %.1f MB/s    --  %i byte \r",
-                params.nbPrefetchs, bestSpeed, (int)runTime.sumOfReturn);
+#define INTERLEAVE_NB_LOGS 4
+static const int interleave_logs[INTERLEAVE_NB_LOGS] = { 8, 10, 12, 14 };
+
+/* sameContent() : @return 1 if both frames decode to the same content */
+static int sameContent(buff a, buff b)
+{
+    size_t const dstCapacity = decSize(a.buffer, a.size);
+    char* const outA = malloc(dstCapacity); assert(outA != NULL);
+    char* const outB = malloc(dstCapacity); assert(outB != NULL);
+    int same;
+    if (decSize(b.buffer, b.size) != dstCapacity) { free(outB); free(outA); return 0; }
+    prefillWarmup(outA, a);
+    prefillWarmup(outB, b);
+    {   size_t const sizeA = decompress(outA, dstCapacity, a.buffer, a.size);
+        size_t const sizeB = decompress(outB, dstCapacity, b.buffer, b.size);
+        same = (sizeA == sizeB) && !memcmp(outA, outB, read_header(a.buffer, a.size).original_size);
+    }
+    free(outB);
+    free(outA);
+    return same;
+}
+
+/* bench_interleave() :
+ * single section layout, in version 2, as reference, then sequences and literals interleaved
+ * by blocks of (1 << blockLog) sequences, or by each of interleave_logs[] when `blockLog` is 0.
+ * decoded with decompress(), or decompress_pref() at `prefetch_level` when > 0.
+ * each layout is checked for identical content first */
+static int bench_interleave(buff sample, int blockLog, int prefetch_level, int bench_nbSeconds)
+{
+    int const nbLogs = blockLog ? 1 : INTERLEAVE_NB_LOGS;
+    int const depth = prefetch_level > 0 ? prefetch_level : 0;
+    if (read_header(sample.buffer, sample.size).block_seqs) {
+        DISPLAY("error : frame is already interleaved \n");
+        return 1;
+    }
+    /* reference in version 2 too : same sequence size as interleaved frames */
+    buff const single = interleave_frame(sample, 0);
+    if (!sameContent(sample, single)) {
+        DISPLAY("error : version 2 frame decodes differently \n");
+        free_buff(single);
+        return 1;
     }
-    DISPLAY("\n");
+    DISPLAY("single section, reference : \n");
+    describeConversion(single);
+    bench_result const ref = bench_variant(depth, single, bench_nbSeconds);
+    free_buff(single);
 
-    BMK_freeTimedFnState(benchState);
+    for (int l = 0; l < nbLogs; l++) {
+        int const log = blockLog ? blockLog : interleave_logs[l];
+        buff const interleaved = interleave_frame(sample, log);
+        if (!sameContent(sample, interleaved)) {
+            DISPLAY("error : interleaved frame decodes differently \n");
+            free_buff(interleaved);
+            return 1;
+        }
+        describeConversion(interleaved);
+        DISPLAY("blocks of %i sequences (", 1 << log);
+        displaySize((size_t)ZF_V2_SEQ_SIZE << log);
+        DISPLAY(" of sequences) : \n");
+        {   bench_result const r = bench_interleaved_variant(depth, interleaved, bench_nbSeconds);
+            DISPLAY("  vs single section : %+.1f%% (median)%s \n",
+                    ref.median_MBps > 0 ? (r.median_MBps - ref.median_MBps) * 100 / ref.median_MBps : 0.,
+                    noiseNote(r.stats, ref.stats));
+        }
+        free_buff(interleaved);
+    }
     return 0;
 }
 
-static int bench_variant(int prefetch_level, buff sample, int bench_nbSeconds)
+/* =========================== */
+/* ***  Absolute positions   *** */
+/* =========================== */
+
+#define ABSOLUTE_NB_DEPTHS 6
+static const int absolute_depths[ABSOLUTE_NB_DEPTHS] = { 0, 4, 8, 16, 32, 64 };
+
+static void displayFrameCost(const char* name, buff frame)
 {
-    assert(prefetch_level >= 0);
-    if (prefetch_level == 0) {
-        benchfn_params params = { .fn = zfdec,
-                                  .payload = NULL,
-                                  .srcBuffer = sample,
-                                  .nbSecs = bench_nbSeconds,
-                                  .nbPrefetchs = 0 };
-        return benchFunction(params);
+    size_t const nbSeqs = read_header(frame.buffer, frame.size).nb_sequences;
+    double const bits = offset_field_entropy(frame.buffer, frame.size);
+    DISPLAY("%-16s : %zu bytes, offset fields entropy %.2f bits / seq (", name, frame.size, bits);
+    displaySize((size_t)(bits * (double)nbSeqs / 8));
+    DISPLAY(" once entropy coded) \n");
+}
+
+/* bench_absolute() :
+ * size cost, then speed of absolute positions (ZF_FLAG_ABSOLUTE) against relative offsets, both in version 2,
+ * at prefetch depth `prefetch_level`, or at each of absolute_depths[] when < 0.
+ * then tells the best depth of each. both frames are checked for identical content first */
+static int bench_absolute(buff sample, int prefetch_level, int bench_nbSeconds)
+{
+    int const nbDepths = prefetch_level >= 0 ? 1 : ABSOLUTE_NB_DEPTHS;
+    frame_header const h = read_header(sample.buffer, sample.size);
+    bench_result bestRel, bestAbs;
+    int bestRelDepth = 0, bestAbsDepth = 0;
+    int result = 0;
+    if (h.block_seqs || (h.flags & ZF_FLAG_ABSOLUTE)) {
+        DISPLAY("error : frame is already interleaved or absolute \n");
+        return 1;
+    }
+    buff const relative = interleave_frame(sample, 0);
+    buff const absolute = absolute_frame(sample);
+    if (!sameContent(sample, relative) || !sameContent(sample, absolute)) {
+        DISPLAY("error : version 2 frames decode differently \n");
+        result = 1;
+        goto _end;
     }
 
-    // prefetch_level > 0
-    benchfn_params params = { .fn = zfpref,
-                              .payload = &prefetch_level,
+    displayFrameCost("original", sample);
+    displayFrameCost("relative offsets", relative);
+    displayFrameCost("absolute", absolute);
+
+    memset(&bestRel, 0, sizeof(bestRel));
+    memset(&bestAbs, 0, sizeof(bestAbs));
+    for (int d = 0; d < nbDepths; d++) {
+        int const depth = prefetch_level >= 0 ? prefetch_level : absolute_depths[d];
+        bench_result rel, abs;
+        describeConversion(relative);
+        rel = bench_variant(depth, relative, bench_nbSeconds);
+        describeConversion(absolute);
+        abs = bench_absolute_variant(depth, absolute, bench_nbSeconds);
+        DISPLAY("  absolute vs relative, depth %i : %+.1f%% (median)%s \n", depth,
+                rel.median_MBps > 0 ? (abs.median_MBps - rel.median_MBps) * 100 / rel.median_MBps : 0.,
+                noiseNote(abs.stats, rel.stats));
+        if (rel.median_MBps > bestRel.median_MBps) { bestRel = rel; bestRelDepth = depth; }
+        if (abs.median_MBps > bestAbs.median_MBps) { bestAbs = abs; bestAbsDepth = depth; }
+    }
+    DISPLAY("best relative : %i prefetchs, median %.1f MB/s \n", bestRelDepth, bestRel.median_MBps);
+    DISPLAY("best absolute : %i prefetchs, median %.1f MB/s%s \n", bestAbsDepth, bestAbs.median_MBps,
+            noiseNote(bestAbs.stats, bestRel.stats));
+
+_end:
+    free_buff(absolute);
+    free_buff(relative);
+    return result;
+}
+
+/* =========================== */
+/* ***     Random access     *** */
+/* =========================== */
+
+#define RANGE_SLICE_SIZE (1 << 20)
+#define RANGE_NB_SLICES 3
+
+static bench_result bench_range_variant(range_payload range, int position, buff sample, int bench_nbSeconds)
+{
+    benchfn_params params = { .fn = zfrange,
+                              .payload = &range,
                               .srcBuffer = sample,
                               .nbSecs = bench_nbSeconds,
-                              .nbPrefetchs = prefetch_level };
-    benchFunction(params);
-
-    return 0;
+                              .nbPrefetchs = position,   /* reported as prefetch parameter */
+                              .paramName = "% position",
+                              .name = "decompress_range" };
+    return benchFunction(params);
 }
 
-static int bench_once(int prefetch_level, int bench_nbSeconds)
+/* sameRange() :
+ * decodes `range` of `sample` with decompress_range(), and the whole frame with decompress().
+ * @return : 1 if the range is identical */
+static int sameRange(buff sample, range_payload range)
 {
-    gen_params gparams = init_gen_params();
-    buff sample = generate(gparams);
+    size_t const dstCapacity = decSize(sample.buffer, sample.size);
+    size_t const warmupSize = read_header(sample.buffer, sample.size).warmup_size;
+    char* const ref = malloc(dstCapacity); assert(ref != NULL);
+    char* const out = malloc(dstCapacity); assert(out != NULL);
+    prefillWarmup(ref, sample);
+    prefillWarmup(out, sample);
+    decompress(ref, dstCapacity, sample.buffer, sample.size);
+    {   size_t const outSize = decompress_range(out, dstCapacity, sample.buffer, sample.size, range.from, range.to);
+        int const same = (outSize == range.to - range.from)
+                      && !memcmp(ref + warmupSize + range.from, out + warmupSize + range.from, outSize);
+        free(out);
+        free(ref);
+        return same;
+    }
+}
 
-    assert(prefetch_level >= 0);
-    bench_variant(prefetch_level, sample, bench_nbSeconds);
+/* bench_range() :
+ * partial decode of slices at start, middle and end of content, with checkpoints every (1 << checkpoint_log) sequences,
+ * against a full decode of the same frame.
+ * first with matches free to reach any earlier segment, then with independent segments */
+static int bench_range(gen_params gparams, int mixId, int bench_nbSeconds)
+{
+    for (int independent = 0; independent <= 1; independent++) {
+        buff sample;
+        frame_header h;
+        size_t contentSize, sliceSize;
+        bench_result full;
+        gparams.independent = independent;
+        sample = generate_sample(gparams, mixId);
+        h = read_header(sample.buffer, sample.size);
+        contentSize = h.original_size - h.warmup_size;
+        sliceSize = MIN(RANGE_SLICE_SIZE, contentSize / 4);
+        if (sliceSize == 0) {
+            DISPLAY("error : content too small for partial decode \n");
+            free_buff(sample);
+            return 1;
+        }
 
-    free_buff(sample);
+        DISPLAY("%s segments : checkpoint every %zu sequences, index %zu bytes, frame %zu bytes \n",
+                independent ? "independent" : "dependent", h.checkpoint_seqs, h.index_size, sample.size);
+        full = bench_variant(0, sample, bench_nbSeconds);
+        for (int n = 0; n < RANGE_NB_SLICES; n++) {
+            int const position = n * 100 / (RANGE_NB_SLICES - 1);
+            range_payload range;
+            range.from = (contentSize - sliceSize) / 100 * (size_t)position;
+            range.to = range.from + sliceSize;
+            if (!sameRange(sample, range)) {
+                DISPLAY("error : partial decode differs from full decode, at %i%% \n", position);
+                free_buff(sample);
+                return 1;
+            }
+            {   size_t const nbSeqs = range_sequences(sample.buffer, sample.size, range.from, range.to);
+                bench_result const r = bench_range_variant(range, position, sample, bench_nbSeconds);
+                DISPLAY("  slice of ");
+                displaySize(sliceSize);
+                DISPLAY(" at %i%% : %.1f%% of sequences decoded, %.1f%% of full decode time (median)%s \n",
+                        position, h.nb_sequences ? (double)nbSeqs * 100 / (double)h.nb_sequences : 0.,
+                        full.stats.median_ns > 0 ? r.stats.median_ns * 100 / full.stats.median_ns : 0.,
+                        noiseNote(r.stats, full.stats));
+        }   }
+        free_buff(sample);
+    }
     return 0;
 }
 
-static int bench_all(int bench_nbSeconds)
+/* =========================== */
+/* ***  Memory-mapped output  *** */
+/* =========================== */
+
+#define OUTPUT_NB_RUNS 3
+#define OUTPUT_CHECK_SIZE (1 << 20)
+
+typedef struct {
+    U64 baseResident;   /* process resident memory before mapping output */
+    U64 peakResident;   /* output part, sampled at each release */
+    int error;
+} output_ctx;
+
+static void sampleResident(output_ctx* ctx)
 {
-    gen_params gparams = init_gen_params();
-    buff sample = generate(gparams);
+    U64 const resident = UTIL_getResidentMemory();
+    if (resident > ctx->baseResident && resident - ctx->baseResident > ctx->peakResident)
+        ctx->peakResident = resident - ctx->baseResident;
+}
 
-    for (int i = 0; i < 50; i++)
-        bench_variant(i, sample, bench_nbSeconds);
+static void releaseOutput(void* opaque, void* chunk, size_t chunkSize) // type ZF_releaseFn
+{
+    output_ctx* const ctx = (output_ctx*)opaque;
+    sampleResident(ctx);
+    ctx->error |= UTIL_releaseMapped(chunk, chunkSize);
+}
 
-    free_buff(sample);
-    return 0;
+/* warm up data, copied by chunks of ZF_RELEASE_CHUNK, each released at once when beyond reach of the first match.
+ * @return : size released, from the start of `map`, for decompress_windowed() to resume from */
+static size_t prefillMapped(char* map, buff sample, size_t windowSize, output_ctx* ctx)
+{
+    frame_header const h = read_header(sample.buffer, sample.size);
+    const char* const warmup = frame_warmup(sample.buffer, h);
+    size_t released = 0;
+    for (size_t pos = 0; pos < h.warmup_size; pos += ZF_RELEASE_CHUNK) {
+        size_t const chunkSize = MIN(ZF_RELEASE_CHUNK, h.warmup_size - pos);
+        memcpy(map + pos, warmup + pos, chunkSize);
+        if (pos + ZF_RELEASE_CHUNK + windowSize <= h.warmup_size) {
+            releaseOutput(ctx, map + pos, ZF_RELEASE_CHUNK);
+            released += ZF_RELEASE_CHUNK;
+    }   }
+    return released;
 }
 
-static int visualize_stats(void)
+/* sameFile() : @return 1 if file `fileName` holds exactly `size` bytes of `ref` */
+static int sameFile(const char* fileName, const char* ref, size_t size)
 {
-    gen_params gparams = init_gen_params();
-    buff sample = generate(gparams);
+    FILE* const f = fopen(fileName, "rb");
+    char* const chunk = malloc(OUTPUT_CHECK_SIZE); assert(chunk != NULL);
+    size_t pos = 0;
+    int same = (f != NULL) && (UTIL_getFileSize(fileName) == (U64)size);
+    while (same && pos < size) {
+        size_t const toRead = MIN(OUTPUT_CHECK_SIZE, size - pos);
+        same = (fread(chunk, 1, toRead, f) == toRead) && !memcmp(chunk, ref + pos, toRead);
+        pos += toRead;
+    }
+    if (f != NULL) fclose(f);
+    free(chunk);
+    return same;
+}
 
-    frame_stats stats;
-    benchfn_params params = { .fn = zfstat,
-                              .payload = &stats,
-                              .srcBuffer = sample,
-                              .nbSecs = 1,
-                              .nbPrefetchs = 0 };
-    benchFunction(params);
+/* bench_output() :
+ * decodes `sample` into file `outName`, warm up data included, 2 ways :
+ * into anonymous memory, then written with fwrite(),
+ * and in place, into the file mapped in memory, releasing output behind the largest offset of the frame.
+ * reports best time of OUTPUT_NB_RUNS runs each, and resident output memory.
+ * file content is checked after both */
+static int bench_output(buff sample, const char* outName)
+{
+    frame_header const h = read_header(sample.buffer, sample.size);
+    size_t const dstCapacity = decSize(sample.buffer, sample.size);
+    size_t const windowSize = collect_stats(sample.buffer, sample.size).offset_max;
+    char* const ref = malloc(dstCapacity); assert(ref != NULL);
+    U64 bestWrite_ns = (U64)-1, bestMapped_ns = (U64)-1;
+    output_ctx ctx;
+    int result = 0;
+    memset(&ctx, 0, sizeof(ctx));
 
-    unsigned const nb_sequences = (unsigned)stats.nb_sequences;
-    DISPLAY("nb sequences : %5u \n", nb_sequences);
-    size_t const total_sequence_length = stats.original_size  - stats.literal_leftover;
-    double const average_sequence_length = (double)total_sequence_length / nb_sequences;
-    DISPLAY("average sequences length : %5.1f \n", average_sequence_length);
-    double const average_match_length = (double)stats.total_match_lengths / nb_sequences;
-    DISPLAY("average match length : %5.1f \n", average_match_length);
-    double const average_literal_length = (double)stats.total_literal_lengths / nb_sequences;
-    DISPLAY("average literal length : %5.1f \n", average_literal_length);
-    DISPLAY("minimum offset : %6u \n", (unsigned)stats.offset_min);
-    DISPLAY("maximum offset : %6u \n", (unsigned)stats.offset_max);
+    for (int run = 0; run < OUTPUT_NB_RUNS; run++) {
+        UTIL_time_t const start = UTIL_getTime();
+        FILE* f;
+        prefillWarmup(ref, sample);
+        decompress(ref, dstCapacity, sample.buffer, sample.size);
+        f = fopen(outName, "wb");
+        if (f == NULL || fwrite(ref, 1, h.original_size, f) != h.original_size) {
+            DISPLAY("error : cannot write %s \n", outName);
+            if (f != NULL) fclose(f);
+            result = 1;
+            goto _end;
+        }
+        fclose(f);
+        {   U64 const span = UTIL_clockSpanNano(start);
+            if (span < bestWrite_ns) bestWrite_ns = span;
+    }   }
+    if (!sameFile(outName, ref, h.original_size)) {
+        DISPLAY("error : %s differs from decoded output \n", outName);
+        result = 1;
+        goto _end;
+    }
 
-    free_buff(sample);
-    return 0;
+    for (int run = 0; run < OUTPUT_NB_RUNS; run++) {
+        U64 const baseResident = UTIL_getResidentMemory();
+        UTIL_time_t const start = UTIL_getTime();
+        char* const map = UTIL_mapOutputFile(outName, dstCapacity);
+        if (map == NULL) {
+            DISPLAY("error : cannot map %s in memory \n", outName);
+            result = 1;
+            goto _end;
+        }
+        ctx.baseResident = baseResident;
+        {   size_t const released = prefillMapped(map, sample, windowSize, &ctx);
+            decompress_windowed(map, dstCapacity, sample.buffer, sample.size, windowSize, released, releaseOutput, &ctx);
+        }
+        sampleResident(&ctx);
+        ctx.error |= UTIL_unmapOutputFile(map, dstCapacity, outName, h.original_size);
+        {   U64 const span = UTIL_clockSpanNano(start);
+            if (span < bestMapped_ns) bestMapped_ns = span;
+    }   }
+    if (ctx.error || !sameFile(outName, ref, h.original_size)) {
+        DISPLAY("error : mapped %s differs from decoded output \n", outName);
+        result = 1;
+        goto _end;
+    }
+
+    DISPLAY("decode, then fwrite()  : %.1f MB/s, ", toMBps(h.original_size - h.warmup_size, (double)bestWrite_ns));
+    displaySize(dstCapacity);
+    DISPLAY(" of anonymous memory \n");
+    DISPLAY("decode into mapped file : %.1f MB/s, ", toMBps(h.original_size - h.warmup_size, (double)bestMapped_ns));
+    if (ctx.peakResident) {
+        DISPLAY("at most ");
+        displaySize((size_t)ctx.peakResident);
+        DISPLAY(" of output resident");
+    } else {
+        DISPLAY("resident output unknown");
+    }
+    DISPLAY(" (window ");
+    displaySize(windowSize);
+    DISPLAY(", best of %i runs) \n", OUTPUT_NB_RUNS);
+
+_end:
+    free(ref);
+    return result;
 }
 
+/* =========================== */
+/* ***   Group prefetching   *** */
+/* =========================== */
+
+#define GROUP_NB_SIZES 9
+static const int group_sizes[GROUP_NB_SIZES] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
 
+/* bench_groups() :
+ * decompress_group() with group size `groupSize`, or each of group_sizes[] when 0,
+ * each one next to the rolling pipeline of decompress_pref() at the same depth.
+ * then tells the best of both strategies */
+static int bench_groups(buff sample, int groupSize, int bench_nbSeconds)
+{
+    int const nbSizes = groupSize ? 1 : GROUP_NB_SIZES;
+    bench_result bestGroup, bestRolling;
+    int bestK = 0, bestDepth = 0;
+    memset(&bestGroup, 0, sizeof(bestGroup));
+    memset(&bestRolling, 0, sizeof(bestRolling));
+
+    for (int g = 0; g < nbSizes; g++) {
+        int K = groupSize ? groupSize : group_sizes[g];
+        if (!sameOutput(sample, zfgroup, &K)) {
+            DISPLAY("error : decompress_group() output differs from decompress() \n");
+            return 1;
+        }
+        {   bench_result const group = bench_group_variant(K, sample, bench_nbSeconds);
+            bench_result const rolling = bench_variant(K, sample, bench_nbSeconds);
+            DISPLAY("  group vs rolling : %+.1f%% (median)%s \n",
+                    rolling.median_MBps > 0 ? (group.median_MBps - rolling.median_MBps) * 100 / rolling.median_MBps : 0.,
+                    noiseNote(group.stats, rolling.stats));
+            if (group.median_MBps > bestGroup.median_MBps) { bestGroup = group; bestK = K; }
+            if (rolling.median_MBps > bestRolling.median_MBps) { bestRolling = rolling; bestDepth = K; }
+    }   }
+
+    if (nbSizes > 1) {
+        DISPLAY("best group : %i sequences, median %.1f MB/s \n", bestK, bestGroup.median_MBps);
+        DISPLAY("best rolling : %i prefetchs, median %.1f MB/s \n", bestDepth, bestRolling.median_MBps);
+        if (!BMK_isSignificant(bestGroup.stats, bestRolling.stats))
+            DISPLAY("best of each strategy can't be told apart%s \n", noiseNote(bestGroup.stats, bestRolling.stats));
+    }
+    return 0;
+}
 
 static void errorOut(const char* msg)
 {
@@ -191,13 +2274,128 @@ static unsigned readU32FromChar(const char** stringPtr)
     return result;
 }
 
+/*! readSizeFromChar() :
+ *  same as readU32FromChar(), but also allows G, GB and GiB suffix,
+ *  producing 64-bit values */
+static size_t readSizeFromChar(const char** stringPtr)
+{
+    const char errorMsg[] = "error: numeric value too large";
+    size_t result = readU32FromChar(stringPtr);
+    if (**stringPtr=='G') {
+        if (result > ((size_t)(-1) >> 30)) errorOut(errorMsg);
+        result <<= 30;
+        (*stringPtr)++;  /* skip `G` */
+        if (**stringPtr=='i') (*stringPtr)++;
+        if (**stringPtr=='B') (*stringPtr)++;
+    }
+    return result;
+}
+
+/*! readLevels() :
+ *  parses a list of SIZE:WAYS[:LATENCY] levels, separated by `,`, such as 48K:12:5,2M:16:16
+ *  latencies default to those of CSIM_defaultConfig()
+ * @return : nb of levels */
+static int readLevels(const char* string, CSIM_levelDesc* levels)
+{
+    int nbLevels = 0;
+    while (*string) {
+        if (nbLevels == CSIM_LEVELS_MAX) errorOut("too many cache levels");
+        levels[nbLevels].size = readSizeFromChar(&string);
+        if (*string++ != ':') errorOut("cache level format : SIZE:WAYS[:LATENCY]");
+        levels[nbLevels].ways = readU32FromChar(&string);
+        if (*string == ':') {
+            string++;
+            levels[nbLevels].latency = readU32FromChar(&string);
+        }
+        nbLevels++;
+        if (*string == ',') string++;
+        else if (*string != 0) errorOut("cache level format : SIZE:WAYS[:LATENCY]");
+    }
+    return nbLevels;
+}
+
 int main(int argCount, const char* argv[])
 {
     unsigned bench_nbSeconds = 4;
     int prefetch_level = -1;
+    int mixId = 0;
+    int sweepMixes = 0;
+    size_t windowSize = 0;
+    int sweepWindows = 0;
+    int sweepHeatmap = 0;
+    int sweepThreads = 0;
+    int nbThreads = 0;
+    int useCounters = 0;
+    int latency = 0;
+    int autoTune = 0;
+    int simulate = 0;
+    int evalPolicies = 0;
+    int verify = 0;
+    int longMatches = 0;
+    int absolute = 0;
+    int blockLog = -1;
+    int checkpointLog = -1;
+    int reorderWindow = -1;
+    int groupSize = -1;
+    CSIM_config cacheModel = CSIM_defaultConfig();
+    REPORT_format_e reportFormat = REPORT_none;
+    const char* reportName = NULL;
+    const char* traceName = NULL;
+    const char* baselineName = NULL;
+    const char* outputName = NULL;
+    double threshold = COMPARE_THRESHOLD_DEFAULT;
 
     for (int argNb=1; argNb<argCount; argNb++) {
         const char* argument = argv[argNb];
+
+        /* Structured results : --csv=FILE or --json=FILE ("-" : stdout) */
+        if (!strncmp(argument, "--csv=", 6)) {
+            reportFormat = REPORT_csv; reportName = argument + 6;
+            continue;
+        }
+        if (!strncmp(argument, "--json=", 7)) {
+            reportFormat = REPORT_json; reportName = argument + 7;
+            continue;
+        }
+
+        /* Decode into file : --output=FILE, written, then mapped in memory */
+        if (!strncmp(argument, "--output=", 9)) {
+            outputName = argument + 9;
+            continue;
+        }
+
+        /* Regression gate : --compare=BASELINE.csv, saved earlier with --csv */
+        if (!strncmp(argument, "--compare=", 10)) {
+            baselineName = argument + 10;
+            continue;
+        }
+        if (!strncmp(argument, "--threshold=", 12)) {
+            threshold = atof(argument + 12);
+            if (threshold < 0) errorOut("invalid threshold");
+            continue;
+        }
+
+        /* Cache model : --cache=SIZE:WAYS[:LATENCY],... from L1, --tlb=ENTRIES:WAYS[:LATENCY],... from L1 dTLB,
+         * --memory=LATENCY[:WALK] in cycles */
+        if (!strncmp(argument, "--cache=", 8)) {
+            cacheModel.nbCaches = readLevels(argument + 8, cacheModel.cache);
+            continue;
+        }
+        if (!strncmp(argument, "--tlb=", 6)) {
+            cacheModel.nbTlbs = readLevels(argument + 6, cacheModel.tlb);
+            continue;
+        }
+        if (!strncmp(argument, "--memory=", 9)) {
+            const char* latencies = argument + 9;
+            cacheModel.memLatency = readU32FromChar(&latencies);
+            if (*latencies == ':') {
+                latencies++;
+                cacheModel.walkLatency = readU32FromChar(&latencies);
+            }
+            if (*latencies != 0) errorOut("memory latency format : LATENCY[:WALK]");
+            continue;
+        }
+
         if (argument[0]=='-') {
             argument++;
             while (argument[0] != 0) {
@@ -215,19 +2413,264 @@ int main(int argCount, const char* argv[])
                     prefetch_level = readU32FromChar(&argument);
                     break;
 
+                /* Select offset mix */
+                case 'm':
+                    argument++;
+                    mixId = readU32FromChar(&argument);
+                    if (mixId >= GEN_NB_MIXES) errorOut("invalid offset mix");
+                    break;
+
+                /* Set window size (maximum offset) */
+                case 'w':
+                    argument++;
+                    windowSize = readSizeFromChar(&argument);
+                    if (windowSize <= 64) errorOut("window size too small");
+                    break;
+
+                /* Sweep window size x prefetch depth */
+                case 'H':
+                    argument++;
+                    sweepHeatmap = 1;
+                    break;
+
+                /* Sweep large windows */
+                case 'W':
+                    argument++;
+                    sweepWindows = 1;
+                    break;
+
+                /* Multi-core scaling : concurrent decoders, optionally fixed nb of threads */
+                case 'T':
+                    argument++;
+                    sweepThreads = 1;
+                    nbThreads = readU32FromChar(&argument);
+                    if (nbThreads > MT_THREADS_MAX) errorOut("too many threads");
+                    break;
+
+                /* Cold runs : -C flushes caches before each decode, -C2 also evicts the TLB */
+                case 'C':
+                    argument++;
+                    {   unsigned const coldLevel = readU32FromChar(&argument);
+                        if (coldLevel > 2) errorOut("invalid cold level");
+                        g_coldFlags = BMK_cold_caches | (coldLevel == 2 ? BMK_cold_tlb : 0);
+                    }
+                    break;
+
+                /* Automatic search of best prefetch depth */
+                case 'A':
+                    argument++;
+                    autoTune = 1;
+                    break;
+
+                /* Small-frame latency percentiles */
+                case 'L':
+                    argument++;
+                    latency = 1;
+                    break;
+
+                /* Time with TSC, report cycles per sequence, far match and byte */
+                case 't':
+                    argument++;
+                    g_useTSC = 1;
+                    break;
+
+                /* Hardware performance counters */
+                case 'P':
+                    argument++;
+                    useCounters = 1;
+                    break;
+
+                /* Replay frame through cache model */
+                case 'S':
+                    argument++;
+                    simulate = 1;
+                    break;
+
+                /* Evaluate prefetch policies on cache model */
+                case 'E':
+                    argument++;
+                    evalPolicies = 1;
+                    break;
+
+                /* Content checksum : fused verification vs separate pass */
+                case 'V':
+                    argument++;
+                    verify = 1;
+                    break;
+
+                /* Long matches, and runs at short offsets */
+                case 'X':
+                    argument++;
+                    longMatches = 1;
+                    break;
+
+                /* Absolute positions : -D alone compares them to relative offsets,
+                 * other modes run on a frame with absolute positions */
+                case 'D':
+                    argument++;
+                    absolute = 1;
+                    break;
+
+                /* Interleaved layout : -I# blocks of 2^# sequences; -I alone sweeps block sizes,
+                 * or interleaves with default block size for other modes */
+                case 'I':
+                    argument++;
+                    blockLog = readU32FromChar(&argument);
+                    if (blockLog && (blockLog < ZF_BLOCK_LOG_MIN || blockLog > ZF_BLOCK_LOG_MAX)) errorOut("invalid block log");
+                    break;
+
+                /* Checkpoint index : -K# checkpoint every 2^# sequences, -K alone with default interval;
+                 * alone, benches partial decode, other modes run on an indexed frame */
+                case 'K':
+                    argument++;
+                    checkpointLog = readU32FromChar(&argument);
+                    if (!checkpointLog) checkpointLog = ZF_CHECKPOINT_LOG_DEFAULT;
+                    if (checkpointLog < ZF_CHECKPOINT_LOG_MIN || checkpointLog > ZF_CHECKPOINT_LOG_MAX) errorOut("invalid checkpoint log");
+                    break;
+
+                /* Locality-reordered decoder : -R# window in sequences, -R sweeps windows */
+                case 'R':
+                    argument++;
+                    reorderWindow = readU32FromChar(&argument);
+                    if (reorderWindow > ZF_REORDER_WINDOW_MAX) errorOut("reorder window too large");
+                    break;
+
+                /* Group prefetching : -G# group size in sequences, -G sweeps group sizes */
+                case 'G':
+                    argument++;
+                    groupSize = readU32FromChar(&argument);
+                    break;
+
+                /* Sweep all offset mixes */
+                case 'M':
+                    argument++;
+                    sweepMixes = 1;
+                    break;
+
                 default : errorOut("bad command line \n");
 
                 }
             }  //while (argument[0] != 0)
 
+        } else {
+            /* Replay sequence trace */
+            traceName = argument;
         }
     }  // for (int argNb=1; argNb<argCount; argNb++)
 
-    if (prefetch_level == 999)
-        return visualize_stats();
+    if (traceName != NULL && (sweepWindows || sweepHeatmap || sweepThreads || sweepMixes || latency))
+        errorOut("sweeps cannot be combined with a trace");
+    if (traceName != NULL && verify)
+        errorOut("traces have no checksum : -V generates its own frame");
+    if (traceName != NULL && longMatches)
+        errorOut("traces keep their own match lengths : -X generates its own frame");
+    if (traceName != NULL && checkpointLog >= 0)
+        errorOut("traces have no checkpoint index : -K generates its own frame");
+    if (checkpointLog >= 0 && blockLog >= 0)
+        errorOut("checkpoint index needs a single section frame : -K cannot be combined with -I");
+
+    if (g_useTSC) {
+        if (UTIL_tscFrequency() > 0) {
+            DISPLAY("timing with TSC, %.3f GHz \n", UTIL_tscFrequency() / 1e9);
+        } else {
+            DISPLAY("invariant TSC not available : timing with monotonic clock, no cycle count \n");
+            g_useTSC = 0;
+    }   }
+
+    if (useCounters) {
+        g_counters = PERF_create();
+        if (g_counters == NULL)
+            DISPLAY("hardware counters not available on this system : continuing without them \n");
+    }
+
+    if (REPORT_open(reportFormat, reportName))
+        errorOut("cannot open report file");
+
+    int const otherModes = autoTune || simulate || evalPolicies || verify
+                        || reorderWindow >= 0 || groupSize >= 0 || prefetch_level == 999
+                        || outputName != NULL;
+    int result;
+    if (baselineName != NULL) {
+        result = bench_compare(baselineName, threshold, bench_nbSeconds) ? 1 : 0;
+    } else if (sweepWindows) {
+        result = bench_windows(mixId, prefetch_level, bench_nbSeconds);
+    } else if (sweepHeatmap) {
+        result = bench_heatmap(mixId, bench_nbSeconds);
+    } else if (sweepThreads) {
+        gen_params gparams = init_gen_params();
+        if (windowSize) gparams = gen_window(gparams, windowSize);
+        result = bench_scaling(gparams, mixId, nbThreads, prefetch_level, bench_nbSeconds);
+    } else if (sweepMixes) {
+        result = bench_mixes(prefetch_level, bench_nbSeconds);
+    } else if (latency) {
+        result = bench_latency(mixId, windowSize, prefetch_level, bench_nbSeconds);
+    } else if (checkpointLog >= 0 && !otherModes) {
+        gen_params gparams = init_gen_params();
+        if (windowSize) gparams = gen_window(gparams, windowSize);
+        gparams.long_matches = longMatches;
+        gparams.absolute = absolute;
+        gparams.checkpoint_log = checkpointLog;
+        result = bench_range(gparams, mixId, bench_nbSeconds);
+    } else {
+        buff sample;
+        int const absoluteOnly = absolute && blockLog < 0 && checkpointLog < 0 && !otherModes;
+        int const interleaveOnly = (blockLog >= 0) && !otherModes;
+        if (traceName != NULL) {
+            sample = load_sample(traceName);
+            if (sample.buffer == NULL) errorOut("cannot replay trace");
+            if (absolute && !absoluteOnly) {
+                buff const converted = absolute_frame(sample);
+                free_buff(sample);
+                sample = converted;
+                describeConversion(sample);
+            }
+        } else {
+            gen_params gparams = init_gen_params();
+            if (windowSize) gparams = gen_window(gparams, windowSize);
+            gparams.checksum = verify;
+            gparams.long_matches = longMatches;
+            gparams.absolute = absolute && !absoluteOnly;
+            gparams.checkpoint_log = checkpointLog >= 0 ? checkpointLog : 0;
+            sample = generate_sample(gparams, mixId);
+        }
+
+        /* other modes run on the interleaved frame */
+        if (blockLog >= 0 && !interleaveOnly) {
+            buff const interleaved = interleave_frame(sample, blockLog ? blockLog : ZF_BLOCK_LOG_DEFAULT);
+            free_buff(sample);
+            sample = interleaved;
+            describeConversion(sample);
+        }
+
+        if (autoTune)
+            result = bench_tune(sample);
+        else if (simulate)
+            result = bench_simulate(sample, cacheModel);
+        else if (evalPolicies)
+            result = bench_policies(sample, prefetch_level, cacheModel);
+        else if (verify)
+            result = bench_verify(sample, prefetch_level, bench_nbSeconds);
+        else if (reorderWindow >= 0)
+            result = bench_reorder(sample, reorderWindow, bench_nbSeconds);
+        else if (groupSize >= 0)
+            result = bench_groups(sample, groupSize, bench_nbSeconds);
+        else if (outputName != NULL)
+            result = bench_output(sample, outputName);
+        else if (interleaveOnly)
+            result = bench_interleave(sample, blockLog, prefetch_level, bench_nbSeconds);
+        else if (absoluteOnly)
+            result = bench_absolute(sample, prefetch_level, bench_nbSeconds);
+        else if (prefetch_level == 999)
+            result = visualize_stats(sample);
+        else if (prefetch_level >= 0)
+            result = bench_once(sample, prefetch_level, bench_nbSeconds);
+        else
+            result = bench_all(sample, bench_nbSeconds);
 
-    if (prefetch_level >= 0)
-        return bench_once(prefetch_level, bench_nbSeconds);
+        free_buff(sample);
+    }
 
-    return bench_all(bench_nbSeconds);
+    REPORT_close();
+    PERF_free(g_counters);
+    return result;
 }
@@ -0,0 +1,151 @@
+/*
+ * Hardware performance counters, see perfcnt.h
+ */
+
+#include <stdlib.h>   /* calloc, free */
+#include <string.h>   /* memset */
+#include "perfcnt.h"
+
+
+static const char* const eventNames[PERF_NB_EVENTS] = {
+    "cycles",
+    "instructions",
+    "LLC-load-misses",
+    "dTLB-load-misses",
+    "backend-stalls",
+    "L1D-pending-miss",
+    "L1D-pending-cycles",
+};
+
+const char* PERF_eventName(PERF_event_e event)
+{
+    if ((unsigned)event >= PERF_NB_EVENTS) return "unknown";
+    return eventNames[event];
+}
+
+
+#if defined(__linux__)
+
+#include <unistd.h>               /* syscall, read, close */
+#include <sys/ioctl.h>            /* ioctl */
+#include <sys/syscall.h>          /* __NR_perf_event_open */
+#include <linux/perf_event.h>     /* perf_event_attr */
+#if defined(__x86_64__) || defined(__i386__)
+#  include <cpuid.h>              /* __get_cpuid */
+#endif
+
+struct PERF_counters_s {
+    int fd[PERF_NB_EVENTS];
+};
+
+static int isIntel(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return 0;
+    return (ebx == 0x756e6547) && (edx == 0x49656e69) && (ecx == 0x6c65746e);   /* "GenuineIntel" */
+#else
+    return 0;
+#endif
+}
+
+static int openEvent(unsigned type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1 /* no group */, 0);
+}
+
+#define CACHE_READ_MISS(cache) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+PERF_counters_t* PERF_create(void)
+{
+    PERF_counters_t* const c = (PERF_counters_t*)calloc(1, sizeof(*c));
+    if (c == NULL) return NULL;
+    c->fd[PERF_cycles] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    c->fd[PERF_instructions] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    c->fd[PERF_llcLoadMisses] = openEvent(PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL));
+    c->fd[PERF_dtlbLoadMisses] = openEvent(PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB));
+    c->fd[PERF_backendStalls] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_STALLED_CYCLES_BACKEND);
+    if (isIntel()) {
+        /* L1D_PEND_MISS.PENDING : event 0x48, umask 0x01; cmask=1 counts cycles instead */
+        c->fd[PERF_l1dPendingMiss] = openEvent(PERF_TYPE_RAW, 0x0148);
+        c->fd[PERF_l1dPendingMissCycles] = openEvent(PERF_TYPE_RAW, 0x0148 | (1ULL << 24));
+    } else {
+        c->fd[PERF_l1dPendingMiss] = c->fd[PERF_l1dPendingMissCycles] = -1;
+    }
+    if (PERF_nbAvailable(c) == 0) {
+        PERF_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void PERF_free(PERF_counters_t* counters)
+{
+    if (counters == NULL) return;
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+        if (counters->fd[e] >= 0) close(counters->fd[e]);
+    free(counters);
+}
+
+int PERF_nbAvailable(const PERF_counters_t* counters)
+{
+    int n = 0;
+    if (counters == NULL) return 0;
+    for (int e = 0; e < PERF_NB_EVENTS; e++)
+        n += (counters->fd[e] >= 0);
+    return n;
+}
+
+void PERF_start(PERF_counters_t* counters)
+{
+    for (int e = 0; e < PERF_NB_EVENTS; e++) {
+        if (counters->fd[e] < 0) continue;
+        ioctl(counters->fd[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+PERF_values_t PERF_stop(PERF_counters_t* counters)
+{
+    PERF_values_t r;
+    memset(&r, 0, sizeof(r));
+    for (int e = 0; e < PERF_NB_EVENTS; e++) {
+        if (counters->fd[e] < 0) continue;
+        ioctl(counters->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int e = 0; e < PERF_NB_EVENTS; e++) {
+        unsigned long long data[3];   /* value, time enabled, time running */
+        if (counters->fd[e] < 0) continue;
+        if (read(counters->fd[e], data, sizeof(data)) != (ssize_t)sizeof(data)) continue;
+        if (data[2] == 0) continue;   /* never scheduled */
+        r.values[e] = (double)data[0] * ((double)data[1] / (double)data[2]);
+        r.valid[e] = 1;
+    }
+    return r;
+}
+
+#else   /* not linux */
+
+PERF_counters_t* PERF_create(void) { return NULL; }
+void PERF_free(PERF_counters_t* counters) { (void)counters; }
+int PERF_nbAvailable(const PERF_counters_t* counters) { (void)counters; return 0; }
+void PERF_start(PERF_counters_t* counters) { (void)counters; }
+PERF_values_t PERF_stop(PERF_counters_t* counters)
+{
+    PERF_values_t r;
+    (void)counters;
+    memset(&r, 0, sizeof(r));
+    return r;
+}
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Hardware performance counters, using Linux perf_event_open().
+ * Each event is opened independently : events unsupported by the cpu,
+ * the kernel or the virtual machine are simply reported as unavailable.
+ * On other platforms, PERF_create() returns NULL.
+ */
+
+#ifndef PERFCNT_H
+#define PERFCNT_H
+
+typedef enum {
+    PERF_cycles,
+    PERF_instructions,
+    PERF_llcLoadMisses,
+    PERF_dtlbLoadMisses,
+    PERF_backendStalls,
+    PERF_l1dPendingMiss,        /* sum of outstanding L1D misses, each cycle (Intel only) */
+    PERF_l1dPendingMissCycles,  /* cycles with at least one outstanding L1D miss (Intel only) */
+    PERF_NB_EVENTS
+} PERF_event_e;
+
+typedef struct {
+    double values[PERF_NB_EVENTS];   /* scaled if events were multiplexed */
+    int valid[PERF_NB_EVENTS];
+} PERF_values_t;
+
+typedef struct PERF_counters_s PERF_counters_t;
+
+/* @return : NULL if no event can be opened */
+PERF_counters_t* PERF_create(void);
+void PERF_free(PERF_counters_t* counters);
+
+/* nb of events successfully opened */
+int PERF_nbAvailable(const PERF_counters_t* counters);
+
+/* reset and enable all events */
+void PERF_start(PERF_counters_t* counters);
+
+/* disable all events, and read them */
+PERF_values_t PERF_stop(PERF_counters_t* counters);
+
+const char* PERF_eventName(PERF_event_e event);
+
+#endif  /* PERFCNT_H */
@@ -0,0 +1,300 @@
+/*
+ * Machine-readable benchmark results, see report.h
+ */
+
+#include <stdio.h>    /* FILE, fprintf */
+#include <stdlib.h>   /* realloc, strtod */
+#include <string.h>   /* strcmp, strpbrk */
+#include "util.h"     /* UTIL_getCpuModel, UTIL_countPhysicalCores */
+#include "report.h"
+
+
+static struct {
+    REPORT_format_e format;
+    FILE* f;
+    unsigned nbRecords;
+    REPORT_sample_t sample;
+    char host[128];
+    char cpu[128];
+    int physicalCores;
+    int logicalCores;
+} g_report = { REPORT_none, NULL, 0, { "none", "none", 0, 0, 0, 0, 0, 0, 0, 0, 0 }, "", "", 0, 0 };
+
+#if defined(__clang__)
+#  define COMPILER_STRING "clang " __clang_version__
+#elif defined(__GNUC__)
+#  define COMPILER_STRING "gcc " __VERSION__
+#elif defined(__VERSION__)
+#  define COMPILER_STRING __VERSION__
+#else
+#  define COMPILER_STRING "unknown"
+#endif
+
+static const char csvHeader[] =
+    "host,cpu,physical_cores,logical_cores,compiler,"
+    "source,mix,offset_min,offset_max,warmup_size,format,flags,block_log,checkpoint_log,nb_sequences,original_size,"
+    "variant,prefetch,threads,unpinned,cold,best_MBps,median_MBps,ci_low_MBps,ci_high_MBps,nb_runs,ns_per_seq,cycles_per_seq,cycles_per_far_match,cycles_per_byte,p50_us,p90_us,p99_us,p999_us";
+
+
+int REPORT_open(REPORT_format_e format, const char* fileName)
+{
+    REPORT_close();
+    if (format == REPORT_none) return 0;
+    g_report.f = strcmp(fileName, "-") ? fopen(fileName, "w") : stdout;
+    if (g_report.f == NULL) return 1;
+    g_report.format = format;
+    g_report.nbRecords = 0;
+    UTIL_getHostName(g_report.host, sizeof(g_report.host));
+    UTIL_getCpuModel(g_report.cpu, sizeof(g_report.cpu));
+    g_report.physicalCores = UTIL_countPhysicalCores();
+    g_report.logicalCores = UTIL_countLogicalCores();
+    if (format == REPORT_csv) fprintf(g_report.f, "%s\n", csvHeader);
+    else fprintf(g_report.f, "[\n");
+    return 0;
+}
+
+void REPORT_close(void)
+{
+    if (g_report.f == NULL) return;
+    if (g_report.format == REPORT_json) fprintf(g_report.f, "\n]\n");
+    if (g_report.f != stdout) fclose(g_report.f);
+    else fflush(stdout);
+    g_report.f = NULL;
+    g_report.format = REPORT_none;
+}
+
+const char* REPORT_compiler(void)
+{
+    return COMPILER_STRING;
+}
+
+void REPORT_setSample(REPORT_sample_t sample)
+{
+    g_report.sample = sample;
+}
+
+REPORT_sample_t REPORT_getSample(void)
+{
+    return g_report.sample;
+}
+
+
+static void writeString(FILE* f, const char* str, REPORT_format_e format)
+{
+    if (format == REPORT_csv && strpbrk(str, ",\"\n") == NULL) {
+        fputs(str, f);
+        return;
+    }
+    fputc('"', f);
+    for ( ; *str; str++) {
+        if (*str == '"') fputs(format == REPORT_csv ? "\"\"" : "\\\"", f);
+        else if (format == REPORT_json && *str == '\\') fputs("\\\\", f);
+        else if (format == REPORT_json && (unsigned char)*str < 0x20) fprintf(f, "\\u%04x", (unsigned char)*str);
+        else fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+/* each field is written as `name` (json) then value */
+static void writeName(const char* name, int first)
+{
+    if (g_report.format == REPORT_csv) {
+        if (!first) fputc(',', g_report.f);
+        return;
+    }
+    fprintf(g_report.f, "%s\"%s\": ", first ? "" : ", ", name);
+}
+
+static void fieldStr(const char* name, const char* value, int first)
+{
+    writeName(name, first);
+    writeString(g_report.f, value, g_report.format);
+}
+
+static void fieldInt(const char* name, unsigned long long value)
+{
+    writeName(name, 0);
+    fprintf(g_report.f, "%llu", value);
+}
+
+static void fieldDouble(const char* name, double value)
+{
+    writeName(name, 0);
+    fprintf(g_report.f, "%.3f", value);
+}
+
+void REPORT_add(REPORT_record_t r)
+{
+    REPORT_sample_t const* const s = &g_report.sample;
+    if (g_report.f == NULL) return;
+    if (g_report.format == REPORT_json)
+        fprintf(g_report.f, "%s  { ", g_report.nbRecords ? ",\n" : "");
+
+    fieldStr("host", g_report.host, 1);
+    fieldStr("cpu", g_report.cpu, 0);
+    fieldInt("physical_cores", (unsigned long long)g_report.physicalCores);
+    fieldInt("logical_cores", (unsigned long long)g_report.logicalCores);
+    fieldStr("compiler", COMPILER_STRING, 0);
+    fieldStr("source", s->source, 0);
+    fieldStr("mix", s->mix, 0);
+    fieldInt("offset_min", s->offset_min);
+    fieldInt("offset_max", s->offset_max);
+    fieldInt("warmup_size", s->warmup_size);
+    fieldInt("format", s->format_version);
+    fieldInt("flags", s->flags);
+    fieldInt("block_log", s->block_log);
+    fieldInt("checkpoint_log", s->checkpoint_log);
+    fieldInt("nb_sequences", s->nb_sequences);
+    fieldInt("original_size", s->original_size);
+    fieldStr("variant", r.variant, 0);
+    fieldInt("prefetch", (unsigned long long)r.prefetch);
+    fieldInt("threads", (unsigned long long)r.threads);
+    fieldInt("unpinned", (unsigned long long)r.unpinned);
+    fieldInt("cold", r.cold);
+    fieldDouble("best_MBps", r.best_MBps);
+    fieldDouble("median_MBps", r.median_MBps);
+    fieldDouble("ci_low_MBps", r.ciLow_MBps);
+    fieldDouble("ci_high_MBps", r.ciHigh_MBps);
+    fieldInt("nb_runs", r.nb_runs);
+    fieldDouble("ns_per_seq", r.ns_per_seq);
+    fieldDouble("cycles_per_seq", r.cycles_per_seq);
+    fieldDouble("cycles_per_far_match", r.cycles_per_far_match);
+    fieldDouble("cycles_per_byte", r.cycles_per_byte);
+    fieldDouble("p50_us", r.p50_us);
+    fieldDouble("p90_us", r.p90_us);
+    fieldDouble("p99_us", r.p99_us);
+    fieldDouble("p999_us", r.p999_us);
+
+    if (g_report.format == REPORT_json) fprintf(g_report.f, " }");
+    else fputc('\n', g_report.f);
+    g_report.nbRecords++;
+    fflush(g_report.f);
+}
+
+
+/* ====  Reading back a CSV report  ==== */
+
+#define CSV_LINE_MAX   4096
+#define CSV_FIELDS_MAX 64
+
+/* split `line` in place, undoing quoting of writeString().
+ * @return : nb of fields */
+static int splitCSV(char* line, char** fields, int fieldsMax)
+{
+    int nbFields = 0;
+    char* ip = line;
+    while (nbFields < fieldsMax) {
+        char* op = ip;
+        fields[nbFields++] = op;
+        if (*ip == '"') {
+            ip++;
+            while (*ip) {
+                if (ip[0] == '"' && ip[1] == '"') { *op++ = '"'; ip += 2; continue; }
+                if (ip[0] == '"') { ip++; break; }
+                *op++ = *ip++;
+            }
+        }
+        while (*ip && *ip != ',' && *ip != '\n' && *ip != '\r') *op++ = *ip++;
+        if (*ip != ',') { *op = 0; break; }
+        *op = 0;
+        ip++;
+    }
+    return nbFields;
+}
+
+static void copyField(char* dst, const char* src)
+{
+    strncpy(dst, src, REPORT_STRING_MAX - 1);
+    dst[REPORT_STRING_MAX - 1] = 0;
+}
+
+int REPORT_loadCSV(const char* fileName, REPORT_entry_t** entriesPtr)
+{
+    static const char* const names[] = {
+        "host", "cpu", "compiler", "source", "mix", "variant",
+        "offset_min", "offset_max", "warmup_size", "format", "flags", "block_log", "checkpoint_log",
+        "nb_sequences", "original_size",
+        "prefetch", "threads", "cold",
+        "best_MBps", "median_MBps", "ci_low_MBps", "ci_high_MBps", "nb_runs", "ns_per_seq" };
+    enum { c_host, c_cpu, c_compiler, c_source, c_mix, c_variant,
+           c_offset_min, c_offset_max, c_warmup_size, c_format, c_flags, c_block_log, c_checkpoint_log,
+           c_nb_sequences, c_original_size,
+           c_prefetch, c_threads, c_cold,
+           c_best, c_median, c_ciLow, c_ciHigh, c_nb_runs, c_ns_per_seq, c_nbColumns };
+    int columns[c_nbColumns];
+    char line[CSV_LINE_MAX];
+    char* fields[CSV_FIELDS_MAX];
+    REPORT_entry_t* entries = NULL;
+    int nbEntries = 0, capacity = 0;
+    FILE* const f = fopen(fileName, "r");
+    if (f == NULL) return -1;
+
+    /* header : locate columns */
+    if (fgets(line, sizeof(line), f) == NULL) { fclose(f); return -1; }
+    {   int const nbFields = splitCSV(line, fields, CSV_FIELDS_MAX);
+        int c, n;
+        for (c = 0; c < c_nbColumns; c++) {
+            columns[c] = -1;
+            for (n = 0; n < nbFields; n++)
+                if (!strcmp(fields[n], names[c])) columns[c] = n;
+        }
+        if (columns[c_variant] < 0 || columns[c_median] < 0) { fclose(f); return -1; }   /* not a report */
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        int const nbFields = splitCSV(line, fields, CSV_FIELDS_MAX);
+        REPORT_entry_t* e;
+        double values[c_nbColumns];
+        int c;
+        if (nbFields <= columns[c_median]) continue;   /* empty or truncated line */
+        if (nbEntries == capacity) {
+            REPORT_entry_t* const newEntries = (REPORT_entry_t*)realloc(entries, (capacity ? capacity * 2 : 16) * sizeof(*entries));
+            if (newEntries == NULL) { free(entries); fclose(f); return -1; }
+            entries = newEntries;
+            capacity = capacity ? capacity * 2 : 16;
+        }
+        e = &entries[nbEntries++];
+        memset(e, 0, sizeof(*e));
+        for (c = 0; c < c_nbColumns; c++) {
+            const char* const field = (columns[c] >= 0 && columns[c] < nbFields) ? fields[columns[c]] : "";
+            values[c] = strtod(field, NULL);
+            switch (c) {
+            case c_host: copyField(e->host, field); break;
+            case c_cpu: copyField(e->cpu, field); break;
+            case c_compiler: copyField(e->compiler, field); break;
+            case c_source: copyField(e->source, field); break;
+            case c_mix: copyField(e->mix, field); break;
+            case c_variant: copyField(e->variant, field); break;
+            default: break;
+        }   }
+        e->sample.offset_min = (size_t)values[c_offset_min];
+        e->sample.offset_max = (size_t)values[c_offset_max];
+        e->sample.warmup_size = (size_t)values[c_warmup_size];
+        e->sample.format_version = (unsigned)values[c_format];
+        e->sample.flags = (unsigned)values[c_flags];
+        e->sample.block_log = (unsigned)values[c_block_log];
+        e->sample.checkpoint_log = (unsigned)values[c_checkpoint_log];
+        e->sample.nb_sequences = (size_t)values[c_nb_sequences];
+        e->sample.original_size = (size_t)values[c_original_size];
+        e->record.prefetch = (int)values[c_prefetch];
+        e->record.threads = columns[c_threads] >= 0 ? (int)values[c_threads] : 1;
+        e->record.cold = (unsigned)values[c_cold];
+        e->record.best_MBps = values[c_best];
+        e->record.median_MBps = values[c_median];
+        e->record.ciLow_MBps = values[c_ciLow];
+        e->record.ciHigh_MBps = values[c_ciHigh];
+        e->record.nb_runs = (unsigned)values[c_nb_runs];
+        e->record.ns_per_seq = values[c_ns_per_seq];
+    }
+
+    fclose(f);
+    {   int n;   /* entries don't move anymore */
+        for (n = 0; n < nbEntries; n++) {
+            entries[n].sample.source = entries[n].source;
+            entries[n].sample.mix = entries[n].mix;
+            entries[n].record.variant = entries[n].variant;
+    }   }
+    *entriesPtr = entries;
+    return nbEntries;
+}
+
@@ -0,0 +1,95 @@
+/*
+ * Machine-readable benchmark results.
+ * One record per measured variant, written as CSV or JSON,
+ * together with a description of the host and of the benchmarked frame.
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stddef.h>   /* size_t */
+
+typedef enum {
+    REPORT_none,
+    REPORT_csv,
+    REPORT_json
+} REPORT_format_e;
+
+/* REPORT_open() :
+ * start writing records into `fileName` ("-" means stdout).
+ * @return : 0 on success */
+int REPORT_open(REPORT_format_e format, const char* fileName);
+
+/* complete and close output, if any */
+void REPORT_close(void);
+
+/* compiler name and version, as written into reports */
+const char* REPORT_compiler(void);
+
+/* description of frame used by subsequent records */
+typedef struct {
+    const char* source;       /* "generated", or trace file name */
+    const char* mix;          /* offset mix name */
+    size_t offset_min;
+    size_t offset_max;
+    size_t warmup_size;
+    unsigned format_version;
+    unsigned flags;           /* ZF_FLAG_* of frame header */
+    unsigned block_log;       /* ZF_FLAG_INTERLEAVED only, 0 otherwise */
+    unsigned checkpoint_log;  /* ZF_FLAG_INDEX only, 0 otherwise */
+    size_t nb_sequences;
+    size_t original_size;
+} REPORT_sample_t;
+
+void REPORT_setSample(REPORT_sample_t sample);
+REPORT_sample_t REPORT_getSample(void);
+
+typedef struct {
+    const char* variant;      /* decoder name */
+    int prefetch;             /* prefetch depth, or tuning parameter of variant (e.g. reorder window) */
+    int threads;              /* nb of concurrent decoders; speeds are aggregated when > 1 */
+    int unpinned;             /* concurrent decoders which could not be pinned onto their own core */
+    unsigned cold;            /* BMK_coldFlags_e : 0 warm, 1 flushed caches, 3 flushed caches + TLB */
+    double best_MBps;
+    double median_MBps;
+    double ciLow_MBps;        /* confidence interval of the median */
+    double ciHigh_MBps;
+    unsigned nb_runs;
+    double ns_per_seq;        /* from best run */
+    double cycles_per_seq;    /* TSC cycles, from best run, 0 when TSC timer not used */
+    double cycles_per_far_match;
+    double cycles_per_byte;
+    double p50_us;            /* per frame latency percentiles, small-frame mode only, 0 otherwise */
+    double p90_us;
+    double p99_us;
+    double p999_us;
+} REPORT_record_t;
+
+/* REPORT_add() :
+ * write one record. Does nothing if no output is open. */
+void REPORT_add(REPORT_record_t record);
+
+/* ====  Reading back a CSV report, as baseline  ==== */
+
+#define REPORT_STRING_MAX 256
+
+typedef struct {
+    char host[REPORT_STRING_MAX];
+    char cpu[REPORT_STRING_MAX];
+    char compiler[REPORT_STRING_MAX];
+    char source[REPORT_STRING_MAX];
+    char mix[REPORT_STRING_MAX];
+    char variant[REPORT_STRING_MAX];
+    REPORT_sample_t sample;   /* strings point into this entry */
+    REPORT_record_t record;
+} REPORT_entry_t;
+
+/* REPORT_loadCSV() :
+ * read all records of a CSV report written by REPORT_open(REPORT_csv, ...).
+ * columns are identified by name, missing ones are left at 0.
+ * Note : entries are self-referencing, do not copy them.
+ * @return : nb of entries, stored into *entriesPtr, to be released with free(),
+ *           or -1 on error */
+int REPORT_loadCSV(const char* fileName, REPORT_entry_t** entriesPtr);
+
+#endif  /* REPORT_H */
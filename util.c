@@ -16,6 +16,9 @@ extern "C" {
 /*-****************************************
 *  Dependencies
 ******************************************/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#  define _GNU_SOURCE   /* sched_setaffinity, CPU_SET */
+#endif
 #include "util.h"
 
 int UTIL_isRegularFile(const char* infilename)
@@ -317,6 +320,66 @@ UTIL_createFileList(const char **inputNames, unsigned inputNamesNb,
     return fileTable;
 }
 
+/*-****************************************
+*  Memory-mapped output files
+******************************************/
+
+#if PLATFORM_POSIX_VERSION >= 200112L
+#  include <fcntl.h>      /* open */
+#  include <sys/mman.h>   /* mmap, msync, madvise */
+
+void* UTIL_mapOutputFile(const char* fileName, U64 size)
+{
+    void* map;
+    int const fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+    if (size == 0 || (U64)(size_t)size != size || ftruncate(fd, (off_t)size)) { close(fd); return NULL; }
+    map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);   /* mapping keeps file open */
+    return map == MAP_FAILED ? NULL : map;
+}
+
+int UTIL_releaseMapped(void* ptr, size_t size)
+{
+    /* MS_ASYNC : writeback is scheduled, not waited for; dirty pages then belong to page cache only */
+    if (msync(ptr, size, MS_ASYNC)) return 1;
+#if defined(MADV_DONTNEED)
+    if (madvise(ptr, size, MADV_DONTNEED)) return 1;
+#endif
+    return 0;
+}
+
+int UTIL_unmapOutputFile(void* ptr, size_t mapSize, const char* fileName, U64 fileSize)
+{
+    int error = msync(ptr, mapSize, MS_ASYNC);
+    error |= munmap(ptr, mapSize);
+    error |= truncate(fileName, (off_t)fileSize);
+    return error != 0;
+}
+
+#else
+
+void* UTIL_mapOutputFile(const char* fileName, U64 size)
+{
+    (void)fileName; (void)size;
+    return NULL;   /* not supported */
+}
+
+int UTIL_releaseMapped(void* ptr, size_t size)
+{
+    (void)ptr; (void)size;
+    return 1;
+}
+
+int UTIL_unmapOutputFile(void* ptr, size_t mapSize, const char* fileName, U64 fileSize)
+{
+    (void)ptr; (void)mapSize; (void)fileName; (void)fileSize;
+    return 1;
+}
+
+#endif
+
+
 /*-****************************************
 *  Console log
 ******************************************/
@@ -452,6 +515,76 @@ void UTIL_waitForNextTick(void)
     } while (UTIL_getSpanTimeNano(clockStart, clockEnd) == 0);
 }
 
+
+/*-****************************************
+*  Time-stamp counter
+******************************************/
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <cpuid.h>
+#include <x86intrin.h>
+
+/* CPUID.80000007H:EDX[8] : TSC ticks at constant rate, across P- and C-states */
+int UTIL_tscInvariant(void)
+{
+    unsigned a, b, c, d;
+    if (__get_cpuid_max(0x80000000, NULL) < 0x80000007) return 0;
+    __cpuid(0x80000007, a, b, c, d);
+    (void)a; (void)b; (void)c;
+    return (d >> 8) & 1;
+}
+
+U64 UTIL_readTSC(void)
+{
+    _mm_lfence();   /* wait for previous instructions to complete */
+    return __rdtsc();
+}
+
+#else
+
+int UTIL_tscInvariant(void) { return 0; }
+U64 UTIL_readTSC(void) { return 0; }
+
+#endif
+
+#define UTIL_TSC_CALIBRATION_NS  (20 * 1000000ULL)
+#define UTIL_TSC_CALIBRATION_ROUNDS 5
+
+double UTIL_tscFrequency(void)
+{
+    static double frequency = -1.;
+    if (frequency < 0) {
+        frequency = 0;
+        if (UTIL_tscInvariant()) {
+            /* median of a few busy-wait rounds, against monotonic clock */
+            double rounds[UTIL_TSC_CALIBRATION_ROUNDS];
+            int r, i;
+            for (r = 0; r < UTIL_TSC_CALIBRATION_ROUNDS; r++) {
+                UTIL_time_t clockEnd;
+                UTIL_time_t const clockStart = UTIL_getTime();
+                U64 const tscStart = UTIL_readTSC();
+                U64 elapsed_ns;
+                do {
+                    clockEnd = UTIL_getTime();
+                    elapsed_ns = UTIL_getSpanTimeNano(clockStart, clockEnd);
+                } while (elapsed_ns < UTIL_TSC_CALIBRATION_NS);
+                rounds[r] = (double)(UTIL_readTSC() - tscStart) * 1000000000. / (double)elapsed_ns;
+                for (i = r; i > 0 && rounds[i-1] > rounds[i]; i--) {   /* insertion sort */
+                    double const tmp = rounds[i]; rounds[i] = rounds[i-1]; rounds[i-1] = tmp;
+            }   }
+            frequency = rounds[UTIL_TSC_CALIBRATION_ROUNDS / 2];
+    }   }
+    return frequency;
+}
+
+U64 UTIL_tscSpanNano(U64 tscStart, U64 tscEnd)
+{
+    double const frequency = UTIL_tscFrequency();
+    if (frequency <= 0) return 0;
+    return (U64)((double)(tscEnd - tscStart) * 1000000000. / frequency);
+}
+
 /* count the number of physical cores */
 #if defined(_WIN32) || defined(WIN32)
 
@@ -648,6 +781,328 @@ int UTIL_countPhysicalCores(void)
 
 #endif
 
+
+/*-****************************************
+*  Cores topology & affinity
+******************************************/
+
+#if defined(_WIN32)
+
+int UTIL_countLogicalCores(void)
+{
+    SYSTEM_INFO sysinfo;
+    GetSystemInfo(&sysinfo);
+    return (int)sysinfo.dwNumberOfProcessors;
+}
+
+#elif PLATFORM_POSIX_VERSION > 0
+
+int UTIL_countLogicalCores(void)
+{
+    long const nbCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return nbCores > 0 ? (int)nbCores : 1;
+}
+
+#else
+
+int UTIL_countLogicalCores(void)
+{
+    return 1;
+}
+
+#endif
+
+
+#if defined(__linux__)
+
+#include <sched.h>   /* sched_setaffinity */
+
+static int UTIL_readSysCpuValue(int cpu, const char* entry)
+{
+    char path[128];
+    int value = -1;
+    FILE* f;
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%i/topology/%s", cpu, entry);
+    f = fopen(path, "r");
+    if (f == NULL) return -1;
+    if (fscanf(f, "%i", &value) != 1) value = -1;
+    fclose(f);
+    return value;
+}
+
+int UTIL_getCoresOrder(int* cpuTable, int tableSize)
+{
+    int const nbCpus = UTIL_countLogicalCores();
+    int* const coreKeys = (int*)malloc(nbCpus * sizeof(int));
+    int* const siblingRank = (int*)malloc(nbCpus * sizeof(int));
+    int nbPlaced = 0;
+    if (coreKeys == NULL || siblingRank == NULL) {
+        free(coreKeys); free(siblingRank);
+        for (nbPlaced = 0; nbPlaced < nbCpus && nbPlaced < tableSize; nbPlaced++) cpuTable[nbPlaced] = nbPlaced;
+        return nbPlaced;
+    }
+    for (int cpu = 0; cpu < nbCpus; cpu++) {
+        int const coreId = UTIL_readSysCpuValue(cpu, "core_id");
+        int const packageId = UTIL_readSysCpuValue(cpu, "physical_package_id");
+        coreKeys[cpu] = (coreId < 0 || packageId < 0) ? -1 - cpu : (packageId << 16) + coreId;
+        siblingRank[cpu] = 0;
+        for (int prev = 0; prev < cpu; prev++)
+            siblingRank[cpu] += (coreKeys[prev] == coreKeys[cpu]);
+    }
+    /* first hardware thread of each core, then second ones, etc. */
+    for (int rank = 0; nbPlaced < nbCpus && nbPlaced < tableSize; rank++)
+        for (int cpu = 0; cpu < nbCpus && nbPlaced < tableSize; cpu++)
+            if (siblingRank[cpu] == rank) cpuTable[nbPlaced++] = cpu;
+    free(coreKeys); free(siblingRank);
+    return nbPlaced;
+}
+
+int UTIL_pinThread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set);   /* 0 : calling thread */
+}
+
+#else
+
+int UTIL_getCoresOrder(int* cpuTable, int tableSize)
+{
+    int const nbCpus = UTIL_countLogicalCores();
+    int n;
+    for (n = 0; n < nbCpus && n < tableSize; n++) cpuTable[n] = n;
+    return n;
+}
+
+int UTIL_pinThread(int cpu)
+{
+    (void)cpu;
+    return -1;   /* not supported */
+}
+
+#endif
+
+
+/*-****************************************
+*  Host description
+******************************************/
+
+static void UTIL_copyString(char* dst, size_t dstSize, const char* src)
+{
+    if (dstSize == 0) return;
+    strncpy(dst, src, dstSize - 1);
+    dst[dstSize - 1] = 0;
+}
+
+#if defined(__linux__)
+
+void UTIL_getCpuModel(char* dst, size_t dstSize)
+{
+    FILE* const cpuinfo = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    UTIL_copyString(dst, dstSize, "unknown");
+    if (cpuinfo == NULL) return;
+    while (fgets(line, sizeof(line), cpuinfo) != NULL) {
+        if (strncmp(line, "model name", 10) == 0) {
+            const char* sep = strchr(line, ':');
+            if (sep == NULL) break;
+            sep++;
+            while (*sep == ' ' || *sep == '\t') sep++;
+            UTIL_copyString(dst, dstSize, sep);
+            {   size_t const len = strlen(dst);
+                if (len && dst[len-1] == '\n') dst[len-1] = 0;
+            }
+            break;
+    }   }
+    fclose(cpuinfo);
+}
+
+#elif defined(__APPLE__)
+
+#include <sys/sysctl.h>
+
+void UTIL_getCpuModel(char* dst, size_t dstSize)
+{
+    size_t size = dstSize;
+    if (sysctlbyname("machdep.cpu.brand_string", dst, &size, NULL, 0) != 0)
+        UTIL_copyString(dst, dstSize, "unknown");
+}
+
+#else
+
+void UTIL_getCpuModel(char* dst, size_t dstSize)
+{
+    UTIL_copyString(dst, dstSize, "unknown");
+}
+
+#endif
+
+void UTIL_getHostName(char* dst, size_t dstSize)
+{
+#if PLATFORM_POSIX_VERSION > 0
+    if (dstSize && gethostname(dst, dstSize) == 0) {
+        dst[dstSize - 1] = 0;
+        return;
+    }
+#endif
+    UTIL_copyString(dst, dstSize, "unknown");
+}
+
+
+/*-****************************************
+*  Memory
+******************************************/
+
+#if defined(_WIN32)
+
+U64 UTIL_getTotalMemory(void)
+{
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) return 0;
+    return (U64)status.ullTotalPhys;
+}
+
+#elif PLATFORM_POSIX_VERSION > 0 && defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+
+U64 UTIL_getTotalMemory(void)
+{
+    long const nbPages = sysconf(_SC_PHYS_PAGES);
+    long const pageSize = sysconf(_SC_PAGESIZE);
+    if (nbPages <= 0 || pageSize <= 0) return 0;
+    return (U64)nbPages * (U64)pageSize;
+}
+
+#else
+
+U64 UTIL_getTotalMemory(void)
+{
+    return 0;   /* unknown */
+}
+
+#endif
+
+#if defined(__linux__)
+
+U64 UTIL_getResidentMemory(void)
+{
+    unsigned long long nbPages = 0, nbResident = 0;
+    long const pageSize = sysconf(_SC_PAGESIZE);
+    FILE* const statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) return 0;
+    if (fscanf(statm, "%llu %llu", &nbPages, &nbResident) != 2 || pageSize <= 0) nbResident = 0;
+    fclose(statm);
+    return (U64)nbResident * (U64)pageSize;
+}
+
+#else
+
+U64 UTIL_getResidentMemory(void)
+{
+    return 0;   /* unknown */
+}
+
+#endif
+
+
+
+/*-****************************************
+*  Cache and TLB eviction
+******************************************/
+
+#if defined(__linux__)
+#  include <sys/mman.h>   /* madvise */
+#endif
+
+#define UTIL_CACHELINE_SIZE 64
+#define UTIL_PAGE_SIZE      4096
+#define UTIL_EVICT_SIZE     (64 << 20)   /* > any LLC slice, and > 16K pages */
+
+/* shared sweep buffer, allocated on first use, never released */
+static char* UTIL_evictionBuffer(void)
+{
+    static char* buffer = NULL;
+    if (buffer == NULL) {
+        buffer = (char*)malloc(UTIL_EVICT_SIZE);
+        if (buffer == NULL) return NULL;
+#if defined(__linux__) && defined(MADV_NOHUGEPAGE)
+        /* TLB eviction requires one entry per 4 KB page */
+        madvise((void*)((size_t)(buffer + UTIL_PAGE_SIZE - 1) & ~(size_t)(UTIL_PAGE_SIZE - 1)),
+                UTIL_EVICT_SIZE - UTIL_PAGE_SIZE, MADV_NOHUGEPAGE);
+#endif
+        memset(buffer, 1, UTIL_EVICT_SIZE);
+    }
+    return buffer;
+}
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+static int UTIL_hasClflushopt(void)
+{
+    unsigned a, b, c, d;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return 0;
+    return (b >> 23) & 1;
+}
+
+__attribute__((target("clflushopt")))
+static void UTIL_clflushopt(const char* p, const char* end)
+{
+    for ( ; p < end; p += UTIL_CACHELINE_SIZE) _mm_clflushopt((void*)p);
+}
+
+void UTIL_flushCache(const void* ptr, size_t size)
+{
+    static int hasClflushopt = -1;
+    const char* const start = (const char*)((size_t)ptr & ~(size_t)(UTIL_CACHELINE_SIZE - 1));
+    const char* const end = (const char*)ptr + size;
+    if (hasClflushopt < 0) hasClflushopt = UTIL_hasClflushopt();
+    if (hasClflushopt) {
+        UTIL_clflushopt(start, end);
+    } else {
+        const char* p;
+        for (p = start; p < end; p += UTIL_CACHELINE_SIZE) _mm_clflush(p);
+    }
+    _mm_mfence();
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__)
+
+void UTIL_flushCache(const void* ptr, size_t size)
+{
+    const char* p = (const char*)((size_t)ptr & ~(size_t)(UTIL_CACHELINE_SIZE - 1));
+    const char* const end = (const char*)ptr + size;
+    for ( ; p < end; p += UTIL_CACHELINE_SIZE)
+        __asm__ __volatile__("dc civac, %0" : : "r"(p) : "memory");
+    __asm__ __volatile__("dsb ish" : : : "memory");
+}
+
+#else
+
+/* no flush instruction : sweep a buffer larger than last level cache */
+void UTIL_flushCache(const void* ptr, size_t size)
+{
+    volatile char* const buffer = UTIL_evictionBuffer();
+    size_t n;
+    (void)ptr; (void)size;
+    if (buffer == NULL) return;
+    for (n = 0; n < UTIL_EVICT_SIZE; n += UTIL_CACHELINE_SIZE) buffer[n]++;
+}
+
+#endif
+
+int UTIL_evictTLB(void)
+{
+    volatile char* const buffer = UTIL_evictionBuffer();
+    size_t n;
+    if (buffer == NULL) return 1;
+    for (n = 0; n < UTIL_EVICT_SIZE; n += UTIL_PAGE_SIZE) buffer[n]++;
+    return 0;
+}
+
 #if defined (__cplusplus)
 }
 #endif
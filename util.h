@@ -152,6 +152,17 @@ U64 UTIL_clockSpanMicro(UTIL_time_t clockStart);
 U64 UTIL_clockSpanNano(UTIL_time_t clockStart);
 void UTIL_waitForNextTick(void);
 
+/* time-stamp counter, x86 only.
+ * UTIL_tscInvariant() : 1 if TSC runs at constant rate, whatever frequency or sleep states.
+ * UTIL_readTSC() : current TSC value, after completion of previous instructions; 0 when not available.
+ * UTIL_tscFrequency() : TSC ticks per second, calibrated against monotonic clock on first call (~100 ms).
+ *                       0 when TSC is missing or not invariant, in which case it can't be used as a clock.
+ * UTIL_tscSpanNano() : converts a TSC interval into nanoseconds */
+int UTIL_tscInvariant(void);
+U64 UTIL_readTSC(void);
+double UTIL_tscFrequency(void);
+U64 UTIL_tscSpanNano(U64 tscStart, U64 tscEnd);
+
 /*-****************************************
 *  File functions
 ******************************************/
@@ -174,6 +185,16 @@ U64 UTIL_getFileSize(const char* infilename);
 
 U64 UTIL_getTotalFileSize(const char* const * const fileNamesTable, unsigned nbFiles);
 
+/* Memory-mapped output files, for results larger than wanted in anonymous memory.
+ * UTIL_mapOutputFile() : creates or truncates `fileName` to `size` bytes, then maps it shared, for writing in place.
+ *                        @return : mapping address, or NULL on failure, or when the platform has no mapping support.
+ * UTIL_releaseMapped() : schedules writeback of [ptr, ptr+size), then drops its pages from process memory;
+ *                        they are read back from the file if touched again. `ptr` must be page aligned. @return : 0 on success.
+ * UTIL_unmapOutputFile() : schedules writeback, unmaps, then truncates file to `fileSize`. @return : 0 on success. */
+void* UTIL_mapOutputFile(const char* fileName, U64 size);
+int UTIL_releaseMapped(void* ptr, size_t size);
+int UTIL_unmapOutputFile(void* ptr, size_t mapSize, const char* fileName, U64 fileSize);
+
 /*
  * A modified version of realloc().
  * If UTIL_realloc() fails the original block is freed.
@@ -215,6 +236,41 @@ UTIL_STATIC void UTIL_freeFileList(const char** filenameTable, char* allocatedBu
 
 int UTIL_countPhysicalCores(void);
 
+/* returns nb of hardware threads (logical cores) */
+int UTIL_countLogicalCores(void);
+
+/* UTIL_getCoresOrder() :
+ * fill cpuTable with logical core ids, one per physical core first,
+ * followed by remaining SMT siblings.
+ * @return : nb of ids written */
+int UTIL_getCoresOrder(int* cpuTable, int tableSize);
+
+/* pin calling thread onto logical core `cpu`.
+ * @return : 0 on success */
+int UTIL_pinThread(int cpu);
+
+/* host description, "unknown" when not available */
+void UTIL_getCpuModel(char* dst, size_t dstSize);
+void UTIL_getHostName(char* dst, size_t dstSize);
+
+/* returns physical memory size in bytes, or 0 if unknown */
+U64 UTIL_getTotalMemory(void);
+
+/* returns resident memory of calling process in bytes, mapped files included, or 0 if unknown */
+U64 UTIL_getResidentMemory(void);
+
+/* UTIL_flushCache() :
+ * write back and evict [ptr, ptr+size) from all cache levels.
+ * Uses clflushopt / clflush on x86, dc civac on aarch64,
+ * and a large eviction sweep elsewhere. */
+void UTIL_flushCache(const void* ptr, size_t size);
+
+/* UTIL_evictTLB() :
+ * touch one byte in each page of a 64 MB buffer,
+ * replacing most data TLB entries of caller.
+ * @return : 0 on success */
+int UTIL_evictTLB(void);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -0,0 +1,77 @@
+/* CRC32C, see zfcrc.h */
+
+#include <stddef.h>   // size_t
+#include <string.h>   // memcpy
+#include "zfcrc.h"
+
+#define CRC32C_POLY 0x82F63B78U   /* reflected */
+
+static unsigned crc32c_table[256];
+static int crc32c_tableReady = 0;
+
+static void crc32c_initTable(void)
+{
+    for (unsigned n = 0; n < 256; n++) {
+        unsigned c = n;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ ((c & 1) ? CRC32C_POLY : 0);
+        crc32c_table[n] = c;
+    }
+    crc32c_tableReady = 1;
+}
+
+static unsigned crc32c_software(unsigned state, const unsigned char* p, size_t size)
+{
+    if (!crc32c_tableReady) crc32c_initTable();
+    while (size--) state = crc32c_table[(state ^ *p++) & 0xFF] ^ (state >> 8);
+    return state;
+}
+
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+__attribute__((target("sse4.2")))
+static unsigned crc32c_hardware(unsigned state, const unsigned char* p, size_t size)
+{
+    unsigned long long s = state;
+    while (size && ((size_t)p & 7)) { s = _mm_crc32_u8((unsigned)s, *p++); size--; }
+    while (size >= 8) {
+        unsigned long long v;
+        memcpy(&v, p, 8);
+        s = _mm_crc32_u64(s, v);
+        p += 8; size -= 8;
+    }
+    while (size--) s = _mm_crc32_u8((unsigned)s, *p++);
+    return (unsigned)s;
+}
+
+static int crc32c_hasHardware(void)
+{
+    static int hasSSE42 = -1;
+    if (hasSSE42 < 0) {
+        __builtin_cpu_init();
+        hasSSE42 = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+    }
+    return hasSSE42;
+}
+
+unsigned crc32c_update(unsigned state, const void* data, size_t size)
+{
+    if (crc32c_hasHardware()) return crc32c_hardware(state, (const unsigned char*)data, size);
+    return crc32c_software(state, (const unsigned char*)data, size);
+}
+
+#else
+
+unsigned crc32c_update(unsigned state, const void* data, size_t size)
+{
+    return crc32c_software(state, (const unsigned char*)data, size);
+}
+
+#endif
+
+unsigned crc32c(const void* data, size_t size)
+{
+    return crc32c_final(crc32c_update(CRC32C_INIT, data, size));
+}
@@ -0,0 +1,20 @@
+#ifndef ZFCRC_H
+#define ZFCRC_H
+
+#include <stddef.h>   // size_t
+
+/* CRC32C (Castagnoli), content checksum of zf frames.
+ * Uses SSE4.2 crc32 instructions when available, a table otherwise.
+ *
+ * Incremental use : start from CRC32C_INIT, feed consecutive chunks to crc32c_update(),
+ * then finalize with crc32c_final(). crc32c() does all three. */
+
+#define CRC32C_INIT 0xFFFFFFFFU
+
+unsigned crc32c_update(unsigned state, const void* data, size_t size);
+
+#define crc32c_final(state) (~(unsigned)(state))
+
+unsigned crc32c(const void* data, size_t size);
+
+#endif  /* ZFCRC_H */
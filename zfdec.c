@@ -3,12 +3,22 @@
 
 
 #include <stddef.h>   // size_t
+#include <stdlib.h>   // malloc, decompress_range
 #include <string.h>   // memcpy
 #include <assert.h>
+#include <pthread.h>  // collect_stats_mt
+#include "zfformat.h"
 #include "zfdec.h"
+#include "zfcrc.h"    // crc32c, decompress_verify
 
-#define MB       * (1 << 20)
-#define PREFIX_SIZE  (16 MB)
+
+#if defined(__GNUC__)
+#  define FORCE_INLINE static inline __attribute__((always_inline))
+#else
+#  define FORCE_INLINE static inline
+#endif
+
+#define MIN(a,b)   ((a) < (b) ? (a) : (b))
 
 
 static int isLittleEndian(void)
@@ -27,88 +37,346 @@ static int MEM_readLE32(const void* p)
     return val;
 }
 
+static unsigned long long MEM_readLE64(const void* p)
+{
+    unsigned long long val;
+    static_assert(sizeof(val) == 8 , "unsigned long long must be a 8-bytes type");
+    assert( isLittleEndian() ); (void)isLittleEndian();
+    memcpy(&val, p, 8);
+    return val;
+}
+
+/* single 8-bytes load, masked : a 6-bytes memcpy() is not always inlined.
+ * reads 2 bytes beyond the offset field, still within frame or its ZF_WILDCOPY_MARGIN */
+FORCE_INLINE size_t MEM_readLE48(const void* p)
+{
+    unsigned long long val;
+    assert( isLittleEndian() ); (void)isLittleEndian();
+    memcpy(&val, p, 8);
+    return (size_t)(val & ZF_V2_OFFSET_MAX);
+}
+
+/* version 1 offsets are 4 bytes, version 2 ones are 6 bytes */
+FORCE_INLINE size_t readOffset(const char* p, int const wide)
+{
+    return wide ? MEM_readLE48(p) : (size_t)(unsigned)MEM_readLE32(p);
+}
 
-/* format :
- * 4-bytes : original size
- * 4-bytes : compressed size (including header)
- * 4-bytes : nb sequences
- * Sequences : 6 bytes each : 1 - 1 - 4
- *             1 : literal length, required <= 16
- *             1 : match length, required <= 32
- *             4 : offset, required to stay within output buffer
- * 16 MB : warm up data
- * Literals : remaining of compressed size
- *            note : sum of literal lengths must be >= nb literals
- *            Any literal left after last sequence is added to the block
- *
- * note : warmup data + sum of literal + sum of matches must be == original size
- */
+/* offset field of a match starting at `matchPos` in decoded output, warm up data included.
+ * `abs` : frame has ZF_FLAG_ABSOLUTE, field is the position of match source */
+FORCE_INLINE size_t toOffset(size_t field, size_t matchPos, int const abs)
+{
+    if (!abs) return field;
+    assert(field < matchPos);
+    return matchPos - field;
+}
 
-size_t decSize(const void* src, size_t srcSize)
+
+/* format : see zfformat.h */
+
+frame_header read_header(const void* src, size_t srcSize)
 {
+    frame_header h;
+    const char* const ip = src;
     assert(srcSize >= 4); (void)srcSize;
-    return MEM_readLE32(src);
+    if ((unsigned)MEM_readLE32(ip) == ZF_MAGIC_V2) {
+        assert(srcSize >= ZF_V2_HEADER_SIZE);
+        h.version = (unsigned char)ip[4];
+        h.flags = (unsigned char)ip[5];
+        assert(h.version == 2);
+        h.original_size = (size_t)MEM_readLE64(ip + 8);
+        h.compressed_size = (size_t)MEM_readLE64(ip + 16);
+        h.nb_sequences = (size_t)MEM_readLE64(ip + 24);
+        h.warmup_size = (size_t)MEM_readLE64(ip + 32);
+        h.header_size = ZF_V2_HEADER_SIZE;
+        h.seq_size = ZF_V2_SEQ_SIZE;
+        h.checksum_size = (h.flags & ZF_FLAG_CHECKSUM) ? ZF_CHECKSUM_SIZE : 0;
+        h.extension_size = 0;
+        if (h.flags & ZF_FLAG_LONG_MATCHES) {
+            assert(srcSize >= ZF_V2_LONG_HEADER_SIZE);
+            h.header_size = ZF_V2_LONG_HEADER_SIZE;
+            h.extension_size = (size_t)MEM_readLE64(ip + 40);
+        }
+        h.block_seqs = 0;
+        if (h.flags & ZF_FLAG_INTERLEAVED) {
+            unsigned const blockLog = (unsigned char)ip[6];
+            assert(ZF_BLOCK_LOG_MIN <= blockLog && blockLog <= ZF_BLOCK_LOG_MAX);
+            h.block_seqs = (size_t)1 << blockLog;
+        }
+        h.checkpoint_seqs = 0;
+        h.index_size = 0;
+        if (h.flags & ZF_FLAG_INDEX) {
+            unsigned const checkpointLog = (unsigned char)ip[7];
+            assert(ZF_CHECKPOINT_LOG_MIN <= checkpointLog && checkpointLog <= ZF_CHECKPOINT_LOG_MAX);
+            assert(!(h.flags & ZF_FLAG_INTERLEAVED));
+            h.checkpoint_seqs = (size_t)1 << checkpointLog;
+            h.index_size = ((h.nb_sequences + h.checkpoint_seqs - 1) >> checkpointLog) * ZF_CHECKPOINT_SIZE;
+            h.header_size += h.index_size;
+            assert(srcSize >= h.header_size);
+        }
+    } else {
+        assert(srcSize >= ZF_V1_HEADER_SIZE);
+        h.version = 1;
+        h.flags = 0;
+        h.original_size = (size_t)MEM_readLE32(ip);
+        h.compressed_size = (size_t)MEM_readLE32(ip + 4);
+        h.nb_sequences = (size_t)MEM_readLE32(ip + 8);
+        h.warmup_size = ZF_V1_WARMUP_SIZE;
+        h.header_size = ZF_V1_HEADER_SIZE;
+        h.seq_size = ZF_V1_SEQ_SIZE;
+        h.checksum_size = 0;
+        h.extension_size = 0;
+        h.block_seqs = 0;
+        h.checkpoint_seqs = 0;
+        h.index_size = 0;
+    }
+    return h;
 }
 
-#define SEQSIZE 6
-size_t decompress(void* dst, size_t dstCapacity,
-            const void* src, size_t srcSize)
+const char* frame_sequences(const void* src, frame_header h, const char** litPtr)
+{
+    const char* const ip = (const char*)src + h.header_size;
+    if (h.block_seqs) {
+        const char* const seqPtr = ip + h.warmup_size;
+        *litPtr = seqPtr + MIN(h.block_seqs, h.nb_sequences) * h.seq_size;
+        return seqPtr;
+    }
+    *litPtr = ip + h.nb_sequences * h.seq_size + h.warmup_size;
+    return ip;
+}
+
+const char* frame_warmup(const void* src, frame_header h)
+{
+    const char* const ip = (const char*)src + h.header_size;
+    return h.block_seqs ? ip : ip + h.nb_sequences * h.seq_size;
+}
+
+size_t match_offset(frame_header h, const char* seqPtr, size_t matchPos)
+{
+    return toOffset(readOffset(seqPtr + 2, h.version >= 2), matchPos, (h.flags & ZF_FLAG_ABSOLUTE) != 0);
+}
+
+unsigned frame_checksum(const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    if (!h.checksum_size) return 0;
+    return (unsigned)MEM_readLE32((const char*)src + srcSize - ZF_CHECKSUM_SIZE);
+}
+
+size_t decSize(const void* src, size_t srcSize)
+{
+    return read_header(src, srcSize).original_size + ZF_WILDCOPY_MARGIN;
+}
+
+/* sequences and their literals, in frame order.
+ * single section frames are one block, whose literals follow warm up data */
+typedef struct {
+    const char* seqPtr;   /* next sequence */
+    const char* litPtr;   /* its literals */
+    size_t blockLeft;     /* sequences left in current block, next one included */
+    size_t seqsLeft;      /* sequences of following blocks */
+    size_t blockSeqs;
+} seq_cursor;
+
+static seq_cursor cursor_init(const void* src, frame_header h)
+{
+    seq_cursor c;
+    c.seqPtr = frame_sequences(src, h, &c.litPtr);
+    c.blockSeqs = h.block_seqs ? h.block_seqs : h.nb_sequences;
+    c.blockLeft = MIN(c.blockSeqs, h.nb_sequences);
+    c.seqsLeft = h.nb_sequences - c.blockLeft;
+    return c;
+}
+
+/* moves to next sequence, once literals of current one are consumed :
+ * after the last sequence of a block, next block starts at `litPtr` */
+FORCE_INLINE void cursor_next(seq_cursor* c, size_t seqSize)
+{
+    c->seqPtr += seqSize;
+    if (--c->blockLeft == 0 && c->seqsLeft) {
+        c->blockLeft = MIN(c->blockSeqs, c->seqsLeft);
+        c->seqsLeft -= c->blockLeft;
+        c->seqPtr = c->litPtr;
+        c->litPtr += c->blockLeft * seqSize;
+    }
+}
+
+/* match length, read from extension stream when flagged (`ext` : frame has ZF_FLAG_LONG_MATCHES) */
+FORCE_INLINE size_t readMatchLength(const char* seqPtr, const char** extPtrPtr, int const ext)
+{
+    size_t const ml = (size_t)(unsigned char)seqPtr[1];
+    if (ext && ml == ZF_ML_EXT) {
+        size_t const extended = (size_t)(unsigned)MEM_readLE32(*extPtrPtr);
+        *extPtrPtr += ZF_EXT_SIZE;
+        return extended;
+    }
+    return ml;
+}
+
+/* offset < 8 : spread first 8 bytes so that distance between op and match becomes >= 8.
+ * same technique as zstd's overlap copy */
+FORCE_INLINE void overlap_copy8(char** op, const char** match, size_t offset)
 {
-    const char* ip = src;
+    assert(*match < *op);
+    if (offset < 8) {
+        static const unsigned dec32table[] = { 0, 1, 2, 1, 4, 4, 4, 4 };   /* added */
+        static const int dec64table[] = { 8, 8, 8, 7, 8, 9, 10, 11 };      /* subtracted */
+        int const sub2 = dec64table[offset];
+        (*op)[0] = (*match)[0];
+        (*op)[1] = (*match)[1];
+        (*op)[2] = (*match)[2];
+        (*op)[3] = (*match)[3];
+        *match += dec32table[offset];
+        memcpy(*op + 4, *match, 4);
+        *match -= sub2;
+    } else {
+        memcpy(*op, *match, 8);
+    }
+    *match += 8;
+    *op += 8;
+    assert(*op - *match >= 8);
+}
+
+/* matches beyond one wildcopy : longer than 32 bytes, or overlapping their own output (offset < 32).
+ * offset 1 is a byte run, other short offsets replicate their pattern 8 or 16 bytes at a time.
+ * like wildcopies, may write up to ZF_WILDCOPY_MARGIN bytes beyond match end.
+ * @return : match end */
+static char* copy_match_ext(char* op, const char* match, size_t length, size_t offset)
+{
+    char* const oend = op + length;
+    assert(offset >= 1);
+    if (offset >= 32) {
+        do { memcpy(op, match, 32); op += 32; match += 32; } while (op < oend);
+        return oend;
+    }
+    if (offset == 1) {
+        memset(op, match[0], length);
+        return oend;
+    }
+    overlap_copy8(&op, &match, offset);
+    if (op - match >= 16) {
+        while (op < oend) { memcpy(op, match, 16); op += 16; match += 16; }
+    } else {
+        while (op < oend) { memcpy(op, match, 8); op += 8; match += 8; }
+    }
+    return oend;
+}
+
+/* execute one sequence : literals, then match.
+ * both are copied with fixed-size wildcopies,
+ * except long and overlapping matches of frames with ZF_FLAG_LONG_MATCHES (`ext`).
+ * @return : updated op */
+FORCE_INLINE char*
+exec_sequence(char* op, const char** litPtrPtr, const char* litEnd, const char* ostart,
+              int nbLiterals, size_t nbMatches, size_t offset, int const ext)
+{
+    const char* const litPtr = *litPtrPtr;
+
+    // start with literals
+    assert(nbLiterals <= 16);
+    assert(litEnd >= litPtr);
+    assert(nbLiterals <= (litEnd - litPtr)); (void)litEnd;
+    memcpy(op, litPtr, 16);
+    op += nbLiterals;
+    *litPtrPtr = litPtr + nbLiterals;
 
-    size_t const dstSize = MEM_readLE32(ip); ip += 4;
-    assert(dstSize <= dstCapacity); (void)dstSize;
+    // match
+    assert(offset <= (size_t)(op - ostart)); (void)ostart;
+    const char* const match = op - offset;
+    //printf("copying from %i \n", (int)((const char*)match-ostart));
+    if (ext && (nbMatches > 32 || offset < 32))
+        return copy_match_ext(op, match, nbMatches, offset);
+    assert(offset >= 32);
+    assert(nbMatches <= 32);
+    memcpy(op, match, 32);
+    return op + nbMatches;
+}
 
-    size_t const cSize = MEM_readLE32(ip); ip += 4;
-    assert(srcSize == cSize); (void)cSize;
+/* output released by chunks behind the match window, see decompress_windowed() */
+typedef struct {
+    size_t windowSize;
+    size_t released;    /* already released by caller */
+    ZF_releaseFn fn;
+    void* opaque;
+} release_ctx;
+
+FORCE_INLINE size_t
+decompress_generic(void* dst, size_t dstCapacity,
+             const void* src, size_t srcSize,
+                   unsigned* crcPtr, const release_ctx* rel, int const wide, int const ext, int const abs)
+{
+    frame_header const h = read_header(src, srcSize);
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
 
-    int const nbSeqs = MEM_readLE32(ip); ip += 4;
-    const char* seqPtr = ip;
-    ip += nbSeqs * SEQSIZE;
+    assert(h.original_size <= dstCapacity);
+    assert(srcSize == h.compressed_size);
+
+    size_t const nbSeqs = h.nb_sequences;
+    seq_cursor cur = cursor_init(src, h);
 
     char* const ostart = dst;
     char* op = ostart;
     char* const oend = ostart + dstCapacity;
 
     /* skip warm up data */
-    // memcpy(op, ip, PREFIX_SIZE);
-    op += PREFIX_SIZE;
-    ip += PREFIX_SIZE;
+    // memcpy(op, frame_warmup(src, h), h.warmup_size);
+    op += h.warmup_size;
+
+    const char* const litEnd = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    const char* extPtr = litEnd;
 
-    const char* litPtr = ip;
-    const char* const litEnd = (const char*)src + srcSize;
+    /* fused checksum : hashes decoded content by chunks, while still hot in cache */
+    unsigned crc = CRC32C_INIT;
+    const char* crcStart = op;
 
-    for (int seqNb = 0 ; seqNb < nbSeqs ; seqNb++) {  // sequences
+    /* windowed output : next chunk to release, once no match can reach it */
+    char* relStart = ostart + (rel ? rel->released : 0);
+
+    for (size_t seqNb = 0 ; seqNb < nbSeqs ; seqNb++) {  // sequences
         // take commands
-        int const nbLiterals = *seqPtr++;
-        int const nbMatches = *seqPtr++;
-        int const offset = MEM_readLE32(seqPtr); seqPtr += 4;
-
-        // start with literals
-        assert(nbLiterals <= 16);
-        assert(litEnd >= litPtr);
-        assert(nbLiterals <= (litEnd - litPtr));
-        memcpy(op, litPtr, 16);
-        op += nbLiterals;
-        litPtr += nbLiterals;
+        int const nbLiterals = cur.seqPtr[0];
+        size_t const nbMatches = readMatchLength(cur.seqPtr, &extPtr, ext);
+        size_t const offset = toOffset(readOffset(cur.seqPtr + 2, wide), (size_t)(op - ostart) + (size_t)nbLiterals, abs);
 
-        // match
-        const void* match = op - offset;
-        assert(offset >= 32);
-        assert(nbMatches <= 32);
-        assert(offset <= op - ostart);
-        memcpy(op, match, 32);
-        op += nbMatches;
+        op = exec_sequence(op, &cur.litPtr, litEnd, ostart, nbLiterals, nbMatches, offset, ext);
+        cursor_next(&cur, seqSize);
+        if (crcPtr && (size_t)(op - crcStart) >= ZF_VERIFY_CHUNK) {
+            crc = crc32c_update(crc, crcStart, (size_t)(op - crcStart));
+            crcStart = op;
+        }
+        while (rel && (size_t)(op - relStart) >= rel->windowSize + ZF_RELEASE_CHUNK) {
+            rel->fn(rel->opaque, relStart, ZF_RELEASE_CHUNK);
+            relStart += ZF_RELEASE_CHUNK;
+        }
     }
 
     // last literals
-    assert(litPtr <= litEnd);
-    size_t nbLastLiterals = (size_t)(litPtr - litEnd);
+    assert(cur.litPtr <= litEnd);
+    size_t nbLastLiterals = (size_t)(litEnd - cur.litPtr);
     assert((size_t)(oend - op) >= nbLastLiterals); (void)oend;
-    memcpy(op, litPtr, nbLastLiterals);
+    memcpy(op, cur.litPtr, nbLastLiterals);
     op += nbLastLiterals;
 
-    return (size_t)(op - ostart) - PREFIX_SIZE;
+    if (crcPtr) *crcPtr = crc32c_final(crc32c_update(crc, crcStart, (size_t)(op - crcStart)));
+    return (size_t)(op - ostart) - h.warmup_size;
+}
+
+/* decoder specializations : version 1, and version 2 with or without long matches, absolute positions.
+ * ZF_SPECIALIZE(h, generic, args...) calls generic(args..., wide, ext, abs) matching frame `h` */
+#define hasLongMatches(h)   (((h).flags & ZF_FLAG_LONG_MATCHES) != 0)
+#define hasAbsolute(h)      (((h).flags & ZF_FLAG_ABSOLUTE) != 0)
+#define ZF_SPECIALIZE(h, generic, ...)                                       \
+    ( (h).version == 1 ? generic(__VA_ARGS__, 0, 0, 0)                       \
+    : hasAbsolute(h) ? ( hasLongMatches(h) ? generic(__VA_ARGS__, 1, 1, 1)   \
+                                           : generic(__VA_ARGS__, 1, 0, 1) ) \
+    : hasLongMatches(h) ? generic(__VA_ARGS__, 1, 1, 0)                      \
+                        : generic(__VA_ARGS__, 1, 0, 0) )
+
+size_t decompress(void* dst, size_t dstCapacity,
+            const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    return ZF_SPECIALIZE(h, decompress_generic, dst, dstCapacity, src, srcSize, NULL, NULL);
 }
 
 
@@ -116,162 +384,867 @@ size_t decompress(void* dst, size_t dstCapacity,
 #  define prefetch_L1(ptr)   __builtin_prefetch((ptr), 0 /* rw==read */, 3 /* locality */)
 #endif
 
-size_t decompress_pref(void* dst, size_t dstCapacity,
-                 const void* src, size_t srcSize,
-                       int prefRounds)
+/* long match sources : one prefetch per line, beyond the 32 bytes of the wildcopy,
+ * up to LONG_MATCH_PREFETCH_MAX bytes; the decoder catches up with the rest by itself */
+#define LONG_MATCH_PREFETCH_MAX 1024
+#define PREFETCH_LINE_SIZE 64
+
+FORCE_INLINE void prefetch_match(const char* match, size_t length, int const ext)
 {
-    const char* ip = src;
+    prefetch_L1(match);
+    prefetch_L1(match + 31);
+    if (ext && length > 32) {
+        size_t const end = MIN(length, LONG_MATCH_PREFETCH_MAX);
+        for (size_t pos = PREFETCH_LINE_SIZE; pos < end; pos += PREFETCH_LINE_SIZE)
+            prefetch_L1(match + pos);
+    }
+}
 
-    size_t const dstSize = MEM_readLE32(ip); ip += 4;
-    assert(dstSize <= dstCapacity); (void)dstSize;
+FORCE_INLINE size_t
+decompress_pref_generic(void* dst, size_t dstCapacity,
+                  const void* src, size_t srcSize,
+                        int prefRounds, unsigned* crcPtr, int const wide, int const ext, int const abs)
+{
+    frame_header const h = read_header(src, srcSize);
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
 
-    size_t const cSize = MEM_readLE32(ip); ip += 4;
-    assert(srcSize == cSize); (void)cSize;
+    assert(h.original_size <= dstCapacity);
+    assert(srcSize == h.compressed_size);
 
-    int const nbSeqs = MEM_readLE32(ip); ip += 4;
-    const char* seqPtr = ip;
-    ip += nbSeqs * SEQSIZE;
+    size_t const nbSeqs = h.nb_sequences;
+    seq_cursor cur = cursor_init(src, h);
 
     char* const ostart = dst;
     char* op = ostart;
     char* const oend = ostart + dstCapacity;
 
     /* skip warm up data */
-    // memcpy(op, ip, PREFIX_SIZE);
-    op += PREFIX_SIZE;
-    ip += PREFIX_SIZE;
+    // memcpy(op, frame_warmup(src, h), h.warmup_size);
+    op += h.warmup_size;
+
+    const char* const litEnd = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    const char* extPtr = litEnd;
 
-    const char* litPtr = ip;
-    const char* const litEnd = (const char*)src + srcSize;
-    int vpos = PREFIX_SIZE;
+    /* fused checksum : hashes decoded content by chunks, while still hot in cache */
+    unsigned crc = CRC32C_INIT;
+    const char* crcStart = op;
+
+    /* lookahead never reads beyond last sequence */
+    if ((size_t)prefRounds > nbSeqs) prefRounds = (int)nbSeqs;
+    size_t vpos = h.warmup_size;
+    const char* extAhead = extPtr;
+    seq_cursor ahead = cur;
     for (int round=0; round < prefRounds; round++) {
-        vpos += seqPtr[ round * SEQSIZE];
-        vpos += seqPtr[ round * SEQSIZE + 1];
+        int const ll = ahead.seqPtr[0];
+        vpos += ll;
+        vpos += readMatchLength(ahead.seqPtr, &extAhead, ext);
+        ahead.litPtr += ll;
+        cursor_next(&ahead, seqSize);
     }
-    int const seqOffset = prefRounds * SEQSIZE;
+    size_t const nbPrefSeqs = nbSeqs - prefRounds;
 
-    for (int seqNb = 0 ; seqNb < nbSeqs ; seqNb++) {  // sequences
+    size_t seqNb;
+    for (seqNb = 0 ; seqNb < nbPrefSeqs ; seqNb++) {  // sequences
         // prefetch
-        vpos += seqPtr[seqOffset];
-        {   int const nextoffset = MEM_readLE32(seqPtr + seqOffset+2);
-            assert(nextoffset <= vpos);
-            int const nextpos = vpos - nextoffset;
-            prefetch_L1(ostart + nextpos);
-            prefetch_L1(ostart + nextpos + 31);
+        {   int const nextll = ahead.seqPtr[0];
+            vpos += nextll;
+            size_t const nextml = readMatchLength(ahead.seqPtr, &extAhead, ext);
+            size_t const nextfield = readOffset(ahead.seqPtr + 2, wide);
+            assert(abs || nextfield <= vpos);
+            size_t const nextpos = abs ? nextfield : vpos - nextfield;   /* abs : no dependency on vpos */
+            prefetch_match(ostart + nextpos, nextml, ext);
             //printf("prefetching %i \n", nextpos);
+            vpos += nextml;
+            ahead.litPtr += nextll;
+            cursor_next(&ahead, seqSize);
         }
-        vpos += seqPtr[seqOffset+1];
 
         // read commands
-        int const nbLiterals = *seqPtr++;
-        int const nbMatches = *seqPtr++;
-        int const offset = MEM_readLE32(seqPtr); seqPtr += 4;
-
-        // start with literals
-        assert(nbLiterals <= 16);
-        assert(litEnd >= litPtr);
-        assert(nbLiterals <= (litEnd - litPtr));
-        memcpy(op, litPtr, 16);
-        op += nbLiterals;
-        litPtr += nbLiterals;
+        int const nbLiterals = cur.seqPtr[0];
+        size_t const nbMatches = readMatchLength(cur.seqPtr, &extPtr, ext);
+        size_t const offset = toOffset(readOffset(cur.seqPtr + 2, wide), (size_t)(op - ostart) + (size_t)nbLiterals, abs);
 
-        // match
-        assert(offset <= op - ostart);
-        const void* const match = op - offset;
-        //printf("copying from %i \n", (int)((const char*)match-ostart));
-        assert(offset >= 32);
-        assert(nbMatches <= 32);
-        memcpy(op, match, 32);
-        op += nbMatches;
+        op = exec_sequence(op, &cur.litPtr, litEnd, ostart, nbLiterals, nbMatches, offset, ext);
+        cursor_next(&cur, seqSize);
+        if (crcPtr && (size_t)(op - crcStart) >= ZF_VERIFY_CHUNK) {
+            crc = crc32c_update(crc, crcStart, (size_t)(op - crcStart));
+            crcStart = op;
+        }
+    }
+
+    for ( ; seqNb < nbSeqs ; seqNb++) {  // last sequences : nothing left to prefetch
+        int const nbLiterals = cur.seqPtr[0];
+        size_t const nbMatches = readMatchLength(cur.seqPtr, &extPtr, ext);
+        size_t const offset = toOffset(readOffset(cur.seqPtr + 2, wide), (size_t)(op - ostart) + (size_t)nbLiterals, abs);
+
+        op = exec_sequence(op, &cur.litPtr, litEnd, ostart, nbLiterals, nbMatches, offset, ext);
+        cursor_next(&cur, seqSize);
+        if (crcPtr && (size_t)(op - crcStart) >= ZF_VERIFY_CHUNK) {
+            crc = crc32c_update(crc, crcStart, (size_t)(op - crcStart));
+            crcStart = op;
+        }
     }
 
     // last literals
-    {   assert(litPtr <= litEnd);
-        size_t const nbLastLiterals = (size_t)(litPtr - litEnd);
+    {   assert(cur.litPtr <= litEnd);
+        size_t const nbLastLiterals = (size_t)(litEnd - cur.litPtr);
         assert((size_t)(oend - op) >= nbLastLiterals); (void)oend;
-        memcpy(op, litPtr, nbLastLiterals);
+        memcpy(op, cur.litPtr, nbLastLiterals);
         op += nbLastLiterals;
     }
 
-    //printf("dec size = %i \n", (int)(op - ostart) - PREFIX_SIZE);
-    return (size_t)(op - ostart) - PREFIX_SIZE;
+    if (crcPtr) *crcPtr = crc32c_final(crc32c_update(crc, crcStart, (size_t)(op - crcStart)));
+    //printf("dec size = %i \n", (int)(op - ostart - h.warmup_size));
+    return (size_t)(op - ostart) - h.warmup_size;
+}
+
+size_t decompress_pref(void* dst, size_t dstCapacity,
+                 const void* src, size_t srcSize,
+                       int prefRounds)
+{
+    frame_header const h = read_header(src, srcSize);
+    return ZF_SPECIALIZE(h, decompress_pref_generic, dst, dstCapacity, src, srcSize, prefRounds, NULL);
 }
 
 
+/* Group prefetching
+ * prefetches match sources of a whole group of `groupSize` sequences,
+ * then executes the group. Unlike decompress_pref(), prefetches are issued back to back,
+ * and the position of each source is computed once per group, in a separate loop. */
+FORCE_INLINE size_t
+decompress_group_generic(void* dst, size_t dstCapacity,
+                   const void* src, size_t srcSize,
+                         size_t groupSize, int const wide, int const ext, int const abs)
+{
+    frame_header const h = read_header(src, srcSize);
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
 
+    assert(h.original_size <= dstCapacity);
+    assert(srcSize == h.compressed_size);
+    assert(groupSize > 0);
 
-frame_stats collect_stats(const void* src, size_t srcSize)
+    size_t const nbSeqs = h.nb_sequences;
+    seq_cursor cur = cursor_init(src, h);
+
+    char* const ostart = dst;
+    char* op = ostart;
+    char* const oend = ostart + dstCapacity;
+
+    /* skip warm up data */
+    op += h.warmup_size;
+
+    const char* const litEnd = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    const char* extPtr = litEnd;
+
+    for (size_t seqNb = 0; seqNb < nbSeqs; ) {
+        size_t const nbGroupSeqs = MIN(groupSize, nbSeqs - seqNb);
+
+        // prefetch whole group
+        {   seq_cursor p = cur;
+            const char* extAhead = extPtr;
+            size_t vpos = (size_t)(op - ostart);
+            for (size_t n = 0; n < nbGroupSeqs; n++) {
+                int const ll = p.seqPtr[0];
+                size_t const ml = readMatchLength(p.seqPtr, &extAhead, ext);
+                size_t const field = readOffset(p.seqPtr + 2, wide);
+                vpos += (size_t)ll;
+                assert(abs || field <= vpos);
+                prefetch_match(ostart + (abs ? field : vpos - field), ml, ext);
+                vpos += ml;
+                p.litPtr += ll;
+                cursor_next(&p, seqSize);
+        }   }
+
+        // then execute it
+        for (size_t n = 0; n < nbGroupSeqs; n++) {
+            int const nbLiterals = cur.seqPtr[0];
+            size_t const nbMatches = readMatchLength(cur.seqPtr, &extPtr, ext);
+            size_t const offset = toOffset(readOffset(cur.seqPtr + 2, wide), (size_t)(op - ostart) + (size_t)nbLiterals, abs);
+
+            op = exec_sequence(op, &cur.litPtr, litEnd, ostart, nbLiterals, nbMatches, offset, ext);
+            cursor_next(&cur, seqSize);
+        }
+        seqNb += nbGroupSeqs;
+    }
+
+    // last literals
+    {   assert(cur.litPtr <= litEnd);
+        size_t const nbLastLiterals = (size_t)(litEnd - cur.litPtr);
+        assert((size_t)(oend - op) >= nbLastLiterals); (void)oend;
+        memcpy(op, cur.litPtr, nbLastLiterals);
+        op += nbLastLiterals;
+    }
+
+    return (size_t)(op - ostart) - h.warmup_size;
+}
+
+size_t decompress_group(void* dst, size_t dstCapacity,
+                  const void* src, size_t srcSize,
+                        int groupSize)
 {
-    frame_stats result;
-    const char* ip = src;
+    frame_header const h = read_header(src, srcSize);
+    size_t const K = groupSize > 0 ? (size_t)groupSize : ZF_GROUP_SIZE_DEFAULT;
+    return ZF_SPECIALIZE(h, decompress_group_generic, dst, dstCapacity, src, srcSize, K);
+}
+
+size_t decompress_verify(void* dst, size_t dstCapacity,
+                   const void* src, size_t srcSize,
+                         int prefRounds)
+{
+    frame_header const h = read_header(src, srcSize);
+    unsigned crc;
+    size_t dSize;
+    if (!h.checksum_size) return ZF_ERROR_CHECKSUM;
+    if (prefRounds)
+        dSize = ZF_SPECIALIZE(h, decompress_pref_generic, dst, dstCapacity, src, srcSize, prefRounds, &crc);
+    else
+        dSize = ZF_SPECIALIZE(h, decompress_generic, dst, dstCapacity, src, srcSize, &crc, NULL);
+    if (crc != frame_checksum(src, srcSize)) return ZF_ERROR_CHECKSUM;
+    return dSize;
+}
+
+size_t decompress_windowed(void* dst, size_t dstCapacity,
+                     const void* src, size_t srcSize,
+                           size_t windowSize, size_t released, ZF_releaseFn release, void* opaque)
+{
+    frame_header const h = read_header(src, srcSize);
+    release_ctx const rel = { windowSize, released, release, opaque };
+    assert(release != NULL);
+    assert(released % ZF_RELEASE_CHUNK == 0 && released <= h.warmup_size);
+    return ZF_SPECIALIZE(h, decompress_generic, dst, dstCapacity, src, srcSize, NULL, &rel);
+}
 
-    size_t const original_size = MEM_readLE32(ip); ip += 4;
-    result.original_size = original_size;
 
-    size_t const compressed_size = MEM_readLE32(ip); ip += 4;
-    assert(srcSize == compressed_size);
-    result.compressed_size = compressed_size;
+/* Locality-reordered decoding
+ * sequences are decoded by windows of `windowSeqs`.
+ * matches whose source lies entirely before their window are final :
+ * their sources are loaded first, grouped by source page,
+ * into a staging area of one wildcopy per match.
+ * then the window is executed in sequence order, like decompress(),
+ * final matches being copied from the staging area, still in cache.
+ * Output is therefore identical, only the order of far loads changes. */
+#define REORDER_PAGE_LOG 12
+#define REORDER_BUCKETS  256      /* pages are grouped modulo REORDER_BUCKETS : a bucket holds 1 MB apart pages */
 
-    int const nbSeqs = MEM_readLE32(ip); ip += 4;
-    result.nb_sequences = nbSeqs;
-    const char* seqPtr = ip;
-    ip += nbSeqs * SEQSIZE;
+/* counting sort on keys < REORDER_BUCKETS, stable */
+static void sort_by_key(unsigned short* order, const unsigned char* keys, const unsigned short* idx, size_t nb)
+{
+    unsigned short count[REORDER_BUCKETS];
+    memset(count, 0, sizeof(count));
+    for (size_t n = 0; n < nb; n++) count[keys[n]]++;
+    for (unsigned b = 0, sum = 0; b < REORDER_BUCKETS; b++) { unsigned const c = count[b]; count[b] = (unsigned short)sum; sum += c; }
+    for (size_t n = 0; n < nb; n++) order[count[keys[n]]++] = idx[n];
+}
+
+FORCE_INLINE size_t
+decompress_reorder_generic(void* dst, size_t dstCapacity,
+                     const void* src, size_t srcSize,
+                           int windowSeqs, int const wide, int const ext, int const abs)
+{
+    frame_header const h = read_header(src, srcSize);
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
+
+    assert(h.original_size <= dstCapacity);
+    assert(srcSize == h.compressed_size);
+    assert(0 < windowSeqs && windowSeqs <= ZF_REORDER_WINDOW_MAX);
+
+    size_t const nbSeqs = h.nb_sequences;
+    seq_cursor cur = cursor_init(src, h);
+
+    char* const ostart = dst;
+    char* op = ostart;
+    char* const oend = ostart + dstCapacity;
 
     /* skip warm up data */
-    ip += PREFIX_SIZE;
-    size_t literal_leftover = PREFIX_SIZE;
-    size_t total_literals_lengths = 0;
-    size_t literal_length_min = original_size;
-    size_t literal_length_max = 0;
-    size_t total_match_lengths = 0;
-    size_t match_length_min = original_size;
-    size_t match_length_max = 0;
-    size_t offset_min = original_size;
-    size_t offset_max = 0;
-
-
-    const char* litPtr = ip;
-    const char* const litEnd = (const char*)src + srcSize;
-
-    for (int seqNb = 0 ; seqNb < nbSeqs ; seqNb++) {  // sequences
+    op += h.warmup_size;
+
+    const char* const litEnd = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    const char* extPtr = litEnd;
+
+    /* current window */
+    unsigned char litLen[ZF_REORDER_WINDOW_MAX];
+    unsigned matchLen[ZF_REORDER_WINDOW_MAX];
+    unsigned char inPlace[ZF_REORDER_WINDOW_MAX];   /* ext : long or overlapping match, executed by copy_match_ext() */
+    const char* matchFrom[ZF_REORDER_WINDOW_MAX];
+    unsigned short finalIdx[ZF_REORDER_WINDOW_MAX];
+    unsigned char keys[ZF_REORDER_WINDOW_MAX];
+    unsigned short order[ZF_REORDER_WINDOW_MAX];
+    char stage[ZF_REORDER_WINDOW_MAX][32];
+
+    for (size_t seqNb = 0; seqNb < nbSeqs; ) {
+        size_t const nbWinSeqs = MIN((size_t)windowSeqs, nbSeqs - seqNb);
+        size_t const winStart = (size_t)(op - ostart);
+        size_t pos = winStart;
+        size_t nbFinal = 0;
+        seq_cursor parse = cur;
+
+        /* read commands, sort out final matches */
+        for (size_t n = 0; n < nbWinSeqs; n++) {
+            int const nbLiterals = parse.seqPtr[0];
+            size_t const nbMatches = readMatchLength(parse.seqPtr, &extPtr, ext);
+            assert(nbLiterals <= 16);
+            pos += (size_t)nbLiterals;
+            size_t const offset = toOffset(readOffset(parse.seqPtr + 2, wide), pos, abs);
+            parse.litPtr += nbLiterals;
+            cursor_next(&parse, seqSize);
+            int const isInPlace = ext && (nbMatches > 32 || offset < 32);
+
+            assert(isInPlace || nbMatches <= 32);
+            assert(offset <= pos);
+            assert(isInPlace || offset >= 32);
+            {   size_t const srcPos = pos - offset;
+                litLen[n] = (unsigned char)nbLiterals;
+                matchLen[n] = (unsigned)nbMatches;
+                matchFrom[n] = ostart + srcPos;
+                if (ext) inPlace[n] = (unsigned char)isInPlace;
+                if (nbMatches && !isInPlace && srcPos + nbMatches <= winStart) {
+                    keys[nbFinal] = (unsigned char)((srcPos >> REORDER_PAGE_LOG) % REORDER_BUCKETS);
+                    finalIdx[nbFinal] = (unsigned short)n;
+                    nbFinal++;
+            }   }
+            pos += nbMatches;
+        }
+
+        /* load final matches, grouped by source page */
+        sort_by_key(order, keys, finalIdx, nbFinal);
+        for (size_t f = 0; f < nbFinal; f++) {
+            size_t const n = order[f];
+            memcpy(stage[f], matchFrom[n], 32);
+            matchFrom[n] = stage[f];
+        }
+
+        /* execute window, in order */
+        for (size_t n = 0; n < nbWinSeqs; n++) {
+            assert(litLen[n] <= (litEnd - cur.litPtr));
+            memcpy(op, cur.litPtr, 16);
+            op += litLen[n];
+            cur.litPtr += litLen[n];
+            cursor_next(&cur, seqSize);
+            if (ext && inPlace[n]) {
+                op = copy_match_ext(op, matchFrom[n], matchLen[n], (size_t)(op - matchFrom[n]));
+                continue;
+            }
+            memcpy(op, matchFrom[n], 32);
+            op += matchLen[n];
+        }
+        assert((size_t)(op - ostart) == pos);
+        assert(cur.seqPtr == parse.seqPtr && cur.litPtr == parse.litPtr);
+
+        seqNb += nbWinSeqs;
+    }
+
+    // last literals
+    {   assert(cur.litPtr <= litEnd);
+        size_t const nbLastLiterals = (size_t)(litEnd - cur.litPtr);
+        assert((size_t)(oend - op) >= nbLastLiterals); (void)oend;
+        memcpy(op, cur.litPtr, nbLastLiterals);
+        op += nbLastLiterals;
+    }
+
+    return (size_t)(op - ostart) - h.warmup_size;
+}
+
+
+size_t decompress_reorder(void* dst, size_t dstCapacity,
+                    const void* src, size_t srcSize,
+                          int windowSeqs)
+{
+    frame_header const h = read_header(src, srcSize);
+    if (windowSeqs == 0) windowSeqs = ZF_REORDER_WINDOW_DEFAULT;
+    return ZF_SPECIALIZE(h, decompress_reorder_generic, dst, dstCapacity, src, srcSize, windowSeqs);
+}
+
+
+/* Random access
+ * checkpoint k starts segment k, made of sequences from k << checkpoint log,
+ * and tells where its output, literals and extended lengths start.
+ * a range needs the segments producing it, then, transitively, those producing sources of their matches.
+ * segments are planned backward : sources precede their match,
+ * so once a segment is reached, all later segments needing it are known.
+ * needed segments are then decoded forward, each one from its checkpoint, up to range end.
+ * frames without index are a single segment. */
+
+typedef struct {
+    size_t outPos;      /* warm up data included */
+    size_t litOffset;   /* from start of literals */
+    size_t extOffset;   /* from start of extension stream */
+} checkpoint;
+
+static size_t nbSegments(frame_header h)
+{
+    return h.index_size ? h.index_size / ZF_CHECKPOINT_SIZE : 1;
+}
+
+static checkpoint read_checkpoint(const void* src, frame_header h, size_t segNb)
+{
+    checkpoint cp = { h.warmup_size, 0, 0 };
+    if (h.index_size) {
+        const char* const p = (const char*)src + h.header_size - h.index_size + segNb * ZF_CHECKPOINT_SIZE;
+        cp.outPos = (size_t)MEM_readLE64(p);
+        cp.litOffset = (size_t)MEM_readLE64(p + 8);
+        cp.extOffset = (size_t)MEM_readLE64(p + 16);
+    }
+    return cp;
+}
+
+/* last segment starting at or before `pos` */
+static size_t segment_of(const size_t* segStart, size_t nbSegs, size_t pos)
+{
+    size_t lo = 0, hi = nbSegs;
+    while (hi - lo > 1) {
+        size_t const mid = (lo + hi) / 2;
+        if (segStart[mid] <= pos) lo = mid; else hi = mid;
+    }
+    return lo;
+}
+
+/* marks segments producing output [start, end); warm up data is always present */
+static void mark_range(unsigned char* needed, const size_t* segStart, size_t nbSegs, size_t start, size_t end)
+{
+    if (start < segStart[0]) start = segStart[0];
+    if (start >= end) return;
+    for (size_t s = segment_of(segStart, nbSegs, start); s < nbSegs && segStart[s] < end; s++)
+        needed[s] = 1;
+}
+
+/* `start`, `end` : output positions, warm up data included
+ * @return : nb of sequences to decode */
+FORCE_INLINE size_t
+range_plan_generic(const void* src, size_t srcSize, frame_header h,
+                   const size_t* segStart, unsigned char* needed, size_t start, size_t end,
+                   int const wide, int const ext, int const abs)
+{
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
+    size_t const nbSegs = nbSegments(h);
+    size_t const segSeqs = h.checkpoint_seqs ? h.checkpoint_seqs : h.nb_sequences;
+    const char* const seqStart = (const char*)src + h.header_size;
+    const char* const extStart = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    size_t nbSeqs = 0;
+
+    memset(needed, 0, nbSegs);
+    mark_range(needed, segStart, nbSegs, start, end);
+    for (size_t s = nbSegs; s-- > 0; ) {
+        if (!needed[s]) continue;
+        size_t const first = s * segSeqs;
+        size_t const nbSegSeqs = MIN(segSeqs, h.nb_sequences - first);
+        checkpoint const cp = read_checkpoint(src, h, s);
+        const char* seqPtr = seqStart + first * seqSize;
+        const char* extPtr = extStart + cp.extOffset;
+        size_t pos = cp.outPos;
+        for (size_t n = 0; n < nbSegSeqs && pos < end; n++, nbSeqs++) {
+            size_t const ml = readMatchLength(seqPtr, &extPtr, ext);
+            pos += (size_t)(unsigned char)seqPtr[0];
+            {   size_t const srcPos = pos - toOffset(readOffset(seqPtr + 2, wide), pos, abs);
+                /* sources within segment are decoded along */
+                if (ml) mark_range(needed, segStart, nbSegs, srcPos, MIN(srcPos + ml, cp.outPos));
+            }
+            pos += ml;
+            seqPtr += seqSize;
+        }
+    }
+    return nbSeqs;
+}
+
+/* @return : nb of sequences decoded */
+FORCE_INLINE size_t
+range_decode_generic(void* dst, size_t dstCapacity,
+               const void* src, size_t srcSize, frame_header h,
+                     const unsigned char* needed, size_t end,
+                     int const wide, int const ext, int const abs)
+{
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
+    size_t const nbSegs = nbSegments(h);
+    size_t const segSeqs = h.checkpoint_seqs ? h.checkpoint_seqs : h.nb_sequences;
+    const char* litStart;
+    const char* const seqStart = frame_sequences(src, h, &litStart);
+    const char* const litEnd = (const char*)src + srcSize - h.checksum_size - h.extension_size;
+    char* const ostart = dst;
+    size_t nbSeqs = 0;
+
+    assert(h.original_size <= dstCapacity); (void)dstCapacity;
+    assert(srcSize == h.compressed_size);
+    assert(!h.block_seqs);
+
+    for (size_t s = 0; s < nbSegs; s++) {
+        if (!needed[s]) continue;
+        size_t const first = s * segSeqs;
+        size_t const nbSegSeqs = MIN(segSeqs, h.nb_sequences - first);
+        checkpoint const cp = read_checkpoint(src, h, s);
+        const char* seqPtr = seqStart + first * seqSize;
+        const char* litPtr = litStart + cp.litOffset;
+        const char* extPtr = litEnd + cp.extOffset;
+        char* op = ostart + cp.outPos;
+        size_t n;
+        for (n = 0; n < nbSegSeqs && (size_t)(op - ostart) < end; n++) {
+            int const nbLiterals = seqPtr[0];
+            size_t const nbMatches = readMatchLength(seqPtr, &extPtr, ext);
+            size_t const offset = toOffset(readOffset(seqPtr + 2, wide), (size_t)(op - ostart) + (size_t)nbLiterals, abs);
+            op = exec_sequence(op, &litPtr, litEnd, ostart, nbLiterals, nbMatches, offset, ext);
+            seqPtr += seqSize;
+        }
+        nbSeqs += n;
+
+        // last literals
+        if (first + n == h.nb_sequences && (size_t)(op - ostart) < end) {
+            assert(litPtr <= litEnd);
+            assert((size_t)(op - ostart) + (size_t)(litEnd - litPtr) == h.original_size);
+            memcpy(op, litPtr, (size_t)(litEnd - litPtr));
+        }
+    }
+    return nbSeqs;
+}
+
+/* `needed` : one byte per segment, receives segments to decode
+ * @return : nb of sequences to decode */
+static size_t range_plan(const void* src, size_t srcSize, frame_header h, size_t start, size_t end, unsigned char* needed)
+{
+    size_t const nbSegs = nbSegments(h);
+    size_t* const segStart = malloc(nbSegs * sizeof(*segStart)); assert(segStart != NULL);
+    for (size_t s = 0; s < nbSegs; s++) segStart[s] = read_checkpoint(src, h, s).outPos;
+    {   size_t const nbSeqs = ZF_SPECIALIZE(h, range_plan_generic, src, srcSize, h, segStart, needed, start, end);
+        free(segStart);
+        return nbSeqs;
+    }
+}
+
+size_t decompress_range(void* dst, size_t dstCapacity,
+                  const void* src, size_t srcSize,
+                        size_t from, size_t to)
+{
+    frame_header const h = read_header(src, srcSize);
+    if (from > to || to > h.original_size - h.warmup_size) return ZF_ERROR_RANGE;
+    {   unsigned char* const needed = malloc(nbSegments(h)); assert(needed != NULL);
+        size_t const nbSeqs = range_plan(src, srcSize, h, h.warmup_size + from, h.warmup_size + to, needed);
+        size_t const nbDecoded = ZF_SPECIALIZE(h, range_decode_generic, dst, dstCapacity, src, srcSize, h, needed, h.warmup_size + to);
+        assert(nbDecoded == nbSeqs); (void)nbSeqs; (void)nbDecoded;
+        free(needed);
+    }
+    return to - from;
+}
+
+size_t range_sequences(const void* src, size_t srcSize, size_t from, size_t to)
+{
+    frame_header const h = read_header(src, srcSize);
+    if (from > to || to > h.original_size - h.warmup_size) return 0;
+    unsigned char* const needed = malloc(nbSegments(h)); assert(needed != NULL);
+    size_t const nbSeqs = range_plan(src, srcSize, h, h.warmup_size + from, h.warmup_size + to, needed);
+    free(needed);
+    return nbSeqs;
+}
+
+
+/* Frame statistics
+ * all variants accumulate sequence ranges into a frame_stats,
+ * min fields start at (size_t)-1, and are bounded by original size when finalized,
+ * so partial results of any split merge into the same totals. */
+
+static void stats_init(frame_stats* acc)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->literal_length_min = (size_t)-1;
+    acc->match_length_min = (size_t)-1;
+    acc->offset_min = (size_t)-1;
+}
+
+static void stats_merge(frame_stats* acc, const frame_stats* part)
+{
+    acc->nb_sequences += part->nb_sequences;
+    acc->total_literal_lengths += part->total_literal_lengths;
+    acc->total_match_lengths += part->total_match_lengths;
+    acc->nb_far_matches += part->nb_far_matches;
+#define STATS_MIN(f) if (part->f < acc->f) acc->f = part->f
+#define STATS_MAX(f) if (part->f > acc->f) acc->f = part->f
+    STATS_MIN(literal_length_min); STATS_MAX(literal_length_max);
+    STATS_MIN(match_length_min);   STATS_MAX(match_length_max);
+    STATS_MIN(offset_min);         STATS_MAX(offset_max);
+#undef STATS_MIN
+#undef STATS_MAX
+}
+
+/* `extPtr` : extension stream of frames with long matches, NULL otherwise
+ * `posPtr` : decoded position at range start, for frames with absolute positions, NULL otherwise;
+ *            updated to range end
+ * @return : extension stream position after range */
+static const char* stats_range_scalar(frame_stats* acc, const char* seqPtr, size_t nbSeqs, int wide,
+                                      const char* extPtr, size_t* posPtr)
+{
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
+    int const ext = (extPtr != NULL);
+    size_t pos = posPtr ? *posPtr : 0;
+    for (size_t seqNb = 0 ; seqNb < nbSeqs ; seqNb++) {  // sequences
         // take commands
-        size_t const literal_length = *seqPtr++;
-        size_t const match_length = *seqPtr++;
-        size_t const offset = MEM_readLE32(seqPtr); seqPtr += 4;
+        size_t const literal_length = (size_t)(unsigned char)seqPtr[0];
+        size_t const match_length = readMatchLength(seqPtr, &extPtr, ext);
+        size_t const field = readOffset(seqPtr + 2, wide); seqPtr += seqSize;
+        size_t const offset = posPtr ? toOffset(field, pos + literal_length, 1) : field;
+        pos += literal_length + match_length;
 
-        // start with literals
+        // literals
         assert(literal_length <= 16);
-        assert(litEnd >= litPtr);
-        assert(literal_length <= (litEnd - litPtr));
-        litPtr += literal_length;
-        total_literals_lengths += literal_length;
-        if (literal_length > literal_length_max) literal_length_max = literal_length;
-        if (literal_length < literal_length_min) literal_length_min = literal_length;
+        acc->total_literal_lengths += literal_length;
+        if (literal_length > acc->literal_length_max) acc->literal_length_max = literal_length;
+        if (literal_length < acc->literal_length_min) acc->literal_length_min = literal_length;
 
         // match
-        assert(offset >= 32);
-        assert(match_length <= 32);
-        total_match_lengths += match_length;
-        if (match_length > match_length_max) match_length_max = match_length;
-        if (match_length < match_length_min) match_length_min = match_length;
-        if (offset > offset_max) offset_max = offset;
-        if (offset < offset_min) offset_min = offset;
+        assert(offset >= (ext ? ZF_LONG_OFFSET_MIN : 32));
+        assert(ext || match_length <= 32);
+        acc->total_match_lengths += match_length;
+        if (match_length > acc->match_length_max) acc->match_length_max = match_length;
+        if (match_length < acc->match_length_min) acc->match_length_min = match_length;
+        if (offset > acc->offset_max) acc->offset_max = offset;
+        if (offset < acc->offset_min) acc->offset_min = offset;
+        acc->nb_far_matches += (offset >= STATS_FAR_OFFSET);
     }
+    acc->nb_sequences += nbSeqs;
+    if (posPtr) *posPtr = pos;
+    return extPtr;
+}
 
-    // last literals
-    assert(litPtr <= litEnd);
-    size_t const nbLastLiterals = (size_t)(litPtr - litEnd);
-    literal_leftover += nbLastLiterals;
-
-    result.total_literal_lengths = total_literals_lengths;
-    result.literal_length_min = literal_length_min;
-    result.literal_length_max = literal_length_max;
-    result.literal_leftover = literal_leftover;
-    result.total_match_lengths = total_match_lengths;
-    result.match_length_max = match_length_max;
-    result.match_length_min = match_length_min;
-    result.offset_min = offset_min;
-    result.offset_max = offset_max;
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+
+#include <immintrin.h>
+
+#define STATS_AVX2 1
+
+/* 4 sequences per vector, one per 64-bit lane : byte 0 literal length, byte 1 match length, offset above.
+ * offsets are < 2^48, so signed 64-bit comparisons are valid */
+__attribute__((target("avx2")))
+static __m256i min64(__m256i a, __m256i b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+
+__attribute__((target("avx2")))
+static __m256i max64(__m256i a, __m256i b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+
+__attribute__((target("avx2")))
+static unsigned long long hsum64(__m256i v)
+{
+    unsigned long long lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+static unsigned long long hmin64(__m256i v)
+{
+    unsigned long long lanes[4], m;
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    m = lanes[0];
+    for (int n = 1; n < 4; n++) if (lanes[n] < m) m = lanes[n];
+    return m;
+}
+
+__attribute__((target("avx2")))
+static unsigned long long hmax64(__m256i v)
+{
+    unsigned long long lanes[4], m;
+    _mm256_storeu_si256((__m256i*)lanes, v);
+    m = lanes[0];
+    for (int n = 1; n < 4; n++) if (lanes[n] > m) m = lanes[n];
+    return m;
+}
+
+/* version 1 : 4 sequences of 6 bytes, 2 per 128-bit half, widened to 8 bytes */
+__attribute__((target("avx2")))
+static __m256i load4_v1(const char* p)
+{
+    __m128i const shuffle = _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1);
+    __m128i const lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)p), shuffle);
+    __m128i const hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(p + 12)), shuffle);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/* lowest or highest of byte `b` over the 4 lanes */
+__attribute__((target("avx2")))
+static size_t laneByte(__m256i v, int b, int highest)
+{
+    unsigned char bytes[32];
+    size_t m;
+    _mm256_storeu_si256((__m256i*)bytes, v);
+    m = bytes[b];
+    for (int n = 1; n < 4; n++) {
+        size_t const x = bytes[8*n + b];
+        if (highest ? x > m : x < m) m = x;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+static void stats_range_avx2(frame_stats* acc, const char* seqPtr, size_t nbSeqs, int wide)
+{
+    size_t const seqSize = wide ? ZF_V2_SEQ_SIZE : ZF_V1_SEQ_SIZE;
+    /* version 1 loads read 4 bytes beyond the 4 sequences : keep them within the range */
+    size_t const nbVec = (nbSeqs >= 1 ? nbSeqs - 1 : 0) / 4;
+    __m256i const byteMask = _mm256_set1_epi64x(0xFF);
+    __m256i const farLimit = _mm256_set1_epi64x(STATS_FAR_OFFSET - 1);
+    __m256i sumLL = _mm256_setzero_si256(), sumML = sumLL, nbFar = sumLL;
+    /* literal and match lengths are bytes 0 and 1 : byte-wise min / max cover them, other bytes are ignored */
+    __m256i minBytes = _mm256_set1_epi8(-1), maxBytes = sumLL;
+    __m256i minOff = _mm256_set1_epi64x(0xFFFFFFFFFFFFLL), maxOff = sumLL;
+
+    for (size_t n = 0; n < nbVec; n++) {
+        __m256i const seqs = wide ? _mm256_loadu_si256((const __m256i*)seqPtr) : load4_v1(seqPtr);
+        __m256i const off = _mm256_srli_epi64(seqs, 16);
+        seqPtr += 4 * seqSize;
+        sumLL = _mm256_add_epi64(sumLL, _mm256_and_si256(seqs, byteMask));
+        sumML = _mm256_add_epi64(sumML, _mm256_and_si256(_mm256_srli_epi64(seqs, 8), byteMask));
+        minBytes = _mm256_min_epu8(minBytes, seqs);
+        maxBytes = _mm256_max_epu8(maxBytes, seqs);
+        minOff = min64(minOff, off);
+        maxOff = max64(maxOff, off);
+        nbFar = _mm256_sub_epi64(nbFar, _mm256_cmpgt_epi64(off, farLimit));
+    }
+
+    if (nbVec) {
+        frame_stats part;
+        part.nb_sequences = 4 * nbVec;
+        part.total_literal_lengths = hsum64(sumLL);
+        part.total_match_lengths = hsum64(sumML);
+        part.nb_far_matches = hsum64(nbFar);
+        part.literal_length_min = laneByte(minBytes, 0, 0); part.literal_length_max = laneByte(maxBytes, 0, 1);
+        part.match_length_min = laneByte(minBytes, 1, 0);   part.match_length_max = laneByte(maxBytes, 1, 1);
+        part.offset_min = hmin64(minOff);                   part.offset_max = hmax64(maxOff);
+        stats_merge(acc, &part);
+    }
+    stats_range_scalar(acc, seqPtr, nbSeqs - 4 * nbVec, wide, NULL, NULL);
+}
+
+static int stats_hasAVX2(void)
+{
+    static int hasAVX2 = -1;
+    if (hasAVX2 < 0) {
+        __builtin_cpu_init();
+        hasAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return hasAVX2;
+}
+
+#endif
+
+/* best available vector implementation, scalar otherwise */
+static void stats_range_vector(frame_stats* acc, const char* seqPtr, size_t nbSeqs, int wide)
+{
+#ifdef STATS_AVX2
+    if (stats_hasAVX2()) {
+        stats_range_avx2(acc, seqPtr, nbSeqs, wide);
+        return;
+    }
+#endif
+    stats_range_scalar(acc, seqPtr, nbSeqs, wide, NULL, NULL);
+}
+
+static frame_stats stats_finalize(const frame_stats* acc, frame_header h, size_t srcSize)
+{
+    frame_stats result = *acc;
+    size_t const literalsSize = srcSize - h.header_size - h.nb_sequences * h.seq_size - h.warmup_size - h.checksum_size - h.extension_size;
+    assert(srcSize == h.compressed_size);
+    assert(result.nb_sequences == h.nb_sequences);
+    assert(result.total_literal_lengths <= literalsSize);
+
+    result.compressed_size = h.compressed_size;
+    result.original_size = h.original_size;
+    result.literal_leftover = h.warmup_size + (literalsSize - result.total_literal_lengths);
+    if (result.literal_length_min > h.original_size) result.literal_length_min = h.original_size;
+    if (result.match_length_min > h.original_size) result.match_length_min = h.original_size;
+    if (result.offset_min > h.original_size) result.offset_min = h.original_size;
     return result;
 }
+
+/* one range per block : literal lengths of a block tell where the next one starts */
+static void stats_blocks(frame_stats* acc, const void* src, size_t srcSize, frame_header h, int vector)
+{
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    const char* extPtr = hasLongMatches(h) ? (const char*)src + srcSize - h.checksum_size - h.extension_size : NULL;
+    size_t const blockSeqs = h.block_seqs ? h.block_seqs : h.nb_sequences;
+    size_t pos = h.warmup_size;
+    size_t* const posPtr = hasAbsolute(h) ? &pos : NULL;
+    assert(!(vector && (extPtr || posPtr)));
+    for (size_t seqNb = 0; seqNb < h.nb_sequences; ) {
+        size_t const nbBlockSeqs = MIN(blockSeqs, h.nb_sequences - seqNb);
+        size_t const litBefore = acc->total_literal_lengths;
+        if (vector)
+            stats_range_vector(acc, seqPtr, nbBlockSeqs, h.version >= 2);
+        else
+            extPtr = stats_range_scalar(acc, seqPtr, nbBlockSeqs, h.version >= 2, extPtr, posPtr);
+        seqNb += nbBlockSeqs;
+        seqPtr = litPtr + (acc->total_literal_lengths - litBefore);
+        litPtr = seqPtr + MIN(blockSeqs, h.nb_sequences - seqNb) * h.seq_size;
+    }
+}
+
+frame_stats collect_stats(const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    frame_stats acc;
+    stats_init(&acc);
+    stats_blocks(&acc, src, srcSize, h, 0);
+    return stats_finalize(&acc, h, srcSize);
+}
+
+frame_stats collect_stats_simd(const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    frame_stats acc;
+    /* match lengths of long matches frames are not all within sequences,
+     * offsets of frames with absolute positions depend on previous sequences */
+    if (hasLongMatches(h) || hasAbsolute(h)) return collect_stats(src, srcSize);
+    stats_init(&acc);
+    stats_blocks(&acc, src, srcSize, h, 1);
+    return stats_finalize(&acc, h, srcSize);
+}
+
+
+typedef struct {
+    const char* seqPtr;
+    size_t nbSeqs;
+    int wide;
+    frame_stats part;
+} stats_job;
+
+static void* stats_worker(void* arg)
+{
+    stats_job* const job = (stats_job*)arg;
+    stats_init(&job->part);
+    stats_range_vector(&job->part, job->seqPtr, job->nbSeqs, job->wide);
+    return NULL;
+}
+
+frame_stats collect_stats_mt(const void* src, size_t srcSize, int nbThreads)
+{
+    frame_header const h = read_header(src, srcSize);
+    const char* const seqStart = (const char*)src + h.header_size;
+    stats_job jobs[STATS_THREADS_MAX];
+    pthread_t threads[STATS_THREADS_MAX];
+    int created[STATS_THREADS_MAX];
+    frame_stats acc;
+
+    /* slices of long matches frames would need their position in extension stream,
+     * slices of interleaved frames the position of their block,
+     * slices of frames with absolute positions their decoded position */
+    if (hasLongMatches(h) || hasAbsolute(h)) return collect_stats(src, srcSize);
+    if (h.block_seqs) return collect_stats_simd(src, srcSize);
+    if (nbThreads < 1) nbThreads = 1;
+    if (nbThreads > STATS_THREADS_MAX) nbThreads = STATS_THREADS_MAX;
+    /* below a few blocks per thread, threads cost more than they save */
+    if ((size_t)nbThreads > h.nb_sequences / STATS_SEQS_PER_THREAD_MIN + 1)
+        nbThreads = (int)(h.nb_sequences / STATS_SEQS_PER_THREAD_MIN + 1);
+
+    for (int t = 0; t < nbThreads; t++) {
+        size_t const first = h.nb_sequences * (size_t)t / (size_t)nbThreads;
+        size_t const last = h.nb_sequences * (size_t)(t+1) / (size_t)nbThreads;
+        jobs[t].seqPtr = seqStart + first * h.seq_size;
+        jobs[t].nbSeqs = last - first;
+        jobs[t].wide = (h.version >= 2);
+        /* first slice runs on calling thread; falls back to it too when a thread can't start */
+        created[t] = (t > 0) && !pthread_create(&threads[t], NULL, stats_worker, &jobs[t]);
+    }
+    for (int t = 0; t < nbThreads; t++)
+        if (!created[t]) stats_worker(&jobs[t]);
+
+    stats_init(&acc);
+    for (int t = 0; t < nbThreads; t++) {
+        if (created[t]) pthread_join(threads[t], NULL);
+        stats_merge(&acc, &jobs[t].part);
+    }
+    return stats_finalize(&acc, h, srcSize);
+}
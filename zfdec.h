@@ -1,6 +1,11 @@
+#ifndef ZFDEC_H
+#define ZFDEC_H
 
 #include <stddef.h>
 
+/* decSize() :
+ * @return : capacity required to decode frame,
+ *           which is its original size + ZF_WILDCOPY_MARGIN */
 size_t decSize(const void* src, size_t srcSize);
 
 size_t decompress(void* dst, size_t dstCapacity,
@@ -13,6 +18,106 @@ size_t decompress_pref(void* dst, size_t dstCapacity,
                  const void* src, size_t srcSize,
                        int prefRounds);
 
+/* decompress_group() :
+ * group prefetching : prefetches match sources of `groupSize` sequences (0 : default),
+ * then executes them, group after group. Same output as decompress(). */
+#define ZF_GROUP_SIZE_DEFAULT 16
+size_t decompress_group(void* dst, size_t dstCapacity,
+                  const void* src, size_t srcSize,
+                        int groupSize);
+
+/* decompress_verify() :
+ * decode like decompress() (prefRounds == 0) or decompress_pref(),
+ * and checksum output while it is still in cache, every ZF_VERIFY_CHUNK bytes.
+ * like other decoders, expects warm up data already present at the start of `dst`.
+ * @return : decoded size, or ZF_ERROR_CHECKSUM if frame has no checksum, or it doesn't match */
+#define ZF_VERIFY_CHUNK 1024
+#define ZF_ERROR_CHECKSUM ((size_t)-1)
+size_t decompress_verify(void* dst, size_t dstCapacity,
+                   const void* src, size_t srcSize,
+                         int prefRounds);
+
+/* decompress_windowed() :
+ * decode like decompress(), into a `dst` too large to stay resident, such as a mapped file.
+ * `dst` is cut in chunks of ZF_RELEASE_CHUNK bytes, from its start, warm up data included.
+ * once decoding position is `windowSize` beyond the end of a chunk, no later match can read it :
+ * it is handed to `release`, in order, which may write it back and drop it from memory.
+ * `windowSize` must cover the largest match offset of the frame (frame_stats.offset_max).
+ * `released` : bytes at the start of `dst` already released by the caller, such as warm up data,
+ * a multiple of ZF_RELEASE_CHUNK; releases resume from there.
+ * output after the last released chunk is left to the caller.
+ * @return : decoded size */
+#define ZF_RELEASE_CHUNK (1 << 20)
+typedef void (*ZF_releaseFn)(void* opaque, void* chunk, size_t chunkSize);
+size_t decompress_windowed(void* dst, size_t dstCapacity,
+                     const void* src, size_t srcSize,
+                           size_t windowSize, size_t released, ZF_releaseFn release, void* opaque);
+
+/* decompress_range() :
+ * decodes bytes [from, to) of content (warm up data excluded, like decompress() output)
+ * at the same place as decompress() would, into `dst` already holding warm up data.
+ * with a checkpoint index (ZF_FLAG_INDEX), only segments of sequences producing the range are decoded,
+ * plus, transitively, those producing the sources of their matches;
+ * without index, sequences are decoded from frame start, up to range end.
+ * rest of `dst` is undefined.
+ * @return : range size, or ZF_ERROR_RANGE if range exceeds content */
+#define ZF_ERROR_RANGE ((size_t)-2)
+size_t decompress_range(void* dst, size_t dstCapacity,
+                  const void* src, size_t srcSize,
+                        size_t from, size_t to);
+
+/* range_sequences() : nb of sequences decompress_range() decodes for range [from, to) */
+size_t range_sequences(const void* src, size_t srcSize, size_t from, size_t to);
+
+/* frame_checksum() : stored content checksum; 0 if frame has none */
+unsigned frame_checksum(const void* src, size_t srcSize);
+
+/* decompress_reorder() :
+ * same output as decompress(), sequences are decoded by windows of `windowSeqs` (0 : default).
+ * within a window, matches whose source precedes the window are executed first,
+ * grouped by source page, for fewer TLB misses and better DRAM row locality.
+ * other matches follow, in sequence order */
+#define ZF_REORDER_WINDOW_DEFAULT 1024
+#define ZF_REORDER_WINDOW_MAX     4096
+size_t decompress_reorder(void* dst, size_t dstCapacity,
+                    const void* src, size_t srcSize,
+                          int windowSeqs);
+
+
+
+
+typedef struct {
+    unsigned version;
+    unsigned flags;
+    size_t original_size;
+    size_t compressed_size;
+    size_t nb_sequences;
+    size_t warmup_size;
+    size_t header_size;     /* checkpoint index included */
+    size_t seq_size;
+    size_t checksum_size;   /* trailing content checksum, 0 if absent */
+    size_t extension_size;  /* extended match lengths, before checksum, 0 if absent */
+    size_t block_seqs;      /* interleaved : sequences per block; 0 : single section of sequences */
+    size_t checkpoint_seqs; /* sequences per checkpoint; 0 : no index */
+    size_t index_size;      /* checkpoint index, at the end of header */
+} frame_header;
+
+/* read_header() :
+ * decode frame header, either version 1 or 2, see zfformat.h */
+frame_header read_header(const void* src, size_t srcSize);
+
+/* frame_sequences() :
+ * @return : first sequence of frame; `*litPtr` receives the position of its literals.
+ * interleaved frames : once a block is complete, next block starts where its literals end */
+const char* frame_sequences(const void* src, frame_header h, const char** litPtr);
+
+/* frame_warmup() : warm up data, to be present at the start of `dst` before decoding */
+const char* frame_warmup(const void* src, frame_header h);
+
+/* match_offset() :
+ * offset of the match of sequence `seqPtr`, starting at `matchPos` in decoded output, warm up data included.
+ * reads either offset field width; frames with ZF_FLAG_ABSOLUTE store the position of the match source */
+size_t match_offset(frame_header h, const char* seqPtr, size_t matchPos);
 
 
 
@@ -29,6 +134,24 @@ typedef struct {
     size_t match_length_max;
     size_t offset_min;
     size_t offset_max;
+    size_t nb_far_matches;    /* offset >= STATS_FAR_OFFSET */
 } frame_stats;
 
+/* beyond this distance, match source is unlikely to be in L2 cache */
+#define STATS_FAR_OFFSET (1 << 20)
+
+/* collect_stats() : reference, one sequence at a time */
 frame_stats collect_stats(const void* src, size_t srcSize);
+
+/* collect_stats_simd() : blocks of sequences in vector registers (AVX2 when available),
+ * same result as collect_stats(). Frames with long matches use collect_stats() */
+frame_stats collect_stats_simd(const void* src, size_t srcSize);
+
+/* collect_stats_mt() : sequence section split across `nbThreads`, using collect_stats_simd() blocks,
+ * partial results merged; same result as collect_stats(). Frames with long matches use collect_stats(),
+ * interleaved frames use collect_stats_simd() */
+#define STATS_THREADS_MAX 256
+#define STATS_SEQS_PER_THREAD_MIN (1 << 16)
+frame_stats collect_stats_mt(const void* src, size_t srcSize, int nbThreads);
+
+#endif  /* ZFDEC_H */
@@ -0,0 +1,108 @@
+#ifndef ZFFORMAT_H
+#define ZFFORMAT_H
+
+/* Frame format, shared by generator and decoders
+ *
+ * version 1 (legacy) :
+ * 4-bytes : original size
+ * 4-bytes : compressed size (including header)
+ * 4-bytes : nb sequences
+ * Sequences : 6 bytes each : 1 - 1 - 4
+ *             1 : literal length, required <= 16
+ *             1 : match length, required <= 32
+ *             4 : offset, required to stay within output buffer; must be >= 32
+ * 16 MB : warm up data
+ * Literals : remaining of compressed size
+ *            note : sum of literal lengths must be >= nb literals
+ *            Any literal left after last sequence is added to the block
+ *
+ * note : warmup data + sum of literal + sum of matches must be == original size
+ *
+ * version 2 : 64-bit sizes, windows beyond 2 GB
+ * 4-bytes : magic number ZF_MAGIC_V2 (can't be a valid version 1 original size)
+ * 1-byte  : version (2)
+ * 1-byte  : flags, see ZF_FLAG_*; other bits reserved, must be 0
+ * 1-byte  : block log, only with ZF_FLAG_INTERLEAVED; 0 otherwise
+ * 1-byte  : checkpoint log, only with ZF_FLAG_INDEX; 0 otherwise
+ * 8-bytes : original size
+ * 8-bytes : compressed size (including header)
+ * 8-bytes : nb sequences
+ * 8-bytes : warm up size
+ * 8-bytes : extension stream size, only with ZF_FLAG_LONG_MATCHES
+ * checkpoint index : only with ZF_FLAG_INDEX, see below
+ * Sequences : 8 bytes each : 1 - 1 - 6
+ *             1 : literal length, required <= 16
+ *             1 : match length, required <= 32
+ *                 with ZF_FLAG_LONG_MATCHES : direct up to ZF_ML_EXT - 1,
+ *                 ZF_ML_EXT : length is next 4-bytes of extension stream
+ *             6 : offset, required to stay within output buffer; must be >= 32
+ *                 with ZF_FLAG_LONG_MATCHES : must be >= 1, matches may overlap their output
+ *                 with ZF_FLAG_ABSOLUTE : position of match source in decoded output, warm up data included,
+ *                 instead of its offset : sources no longer depend on previous sequences
+ * warm up data : warm up size
+ * Literals : same as version 1, up to extension stream or content checksum if present
+ * extension stream : only with ZF_FLAG_LONG_MATCHES :
+ *           4-bytes match lengths, one per ZF_ML_EXT, in sequence order
+ * 4-bytes : content checksum, only with ZF_FLAG_CHECKSUM :
+ *           CRC32C of decoded content, warm up data excluded
+ *
+ * with ZF_FLAG_INTERLEAVED, warm up data directly follows the header,
+ * then come blocks of (1 << block log) sequences, each followed by its literals,
+ * so that sequences and literals are read as a single forward stream.
+ * the last block holds remaining sequences, its literals extend up to extension stream or content checksum.
+ *
+ * with ZF_FLAG_INDEX, one checkpoint per (1 << checkpoint log) sequences, from sequence 0,
+ * so that a segment of sequences can be decoded without the ones before it :
+ * 8-bytes : output position of the checkpoint sequence, warm up data included
+ * 8-bytes : literals before it, from start of literals
+ * 8-bytes : extension stream before it, in bytes
+ * an index can't be combined with ZF_FLAG_INTERLEAVED.
+ *
+ * All fields are little endian.
+ */
+
+#define ZF_MAGIC_V2        0xFD5A4632U
+
+#define ZF_V1_HEADER_SIZE  12
+#define ZF_V1_SEQ_SIZE     6
+#define ZF_V1_WARMUP_SIZE  (16 << 20)
+#define ZF_V1_SIZE_MAX     ((1U << 31) - 1)
+
+#define ZF_V2_HEADER_SIZE  40
+#define ZF_V2_SEQ_SIZE     8
+#define ZF_V2_OFFSET_MAX   ((1ULL << 48) - 1)
+
+#define ZF_FLAG_CHECKSUM   1
+#define ZF_CHECKSUM_SIZE   4
+
+#define ZF_FLAG_LONG_MATCHES  2
+#define ZF_V2_LONG_HEADER_SIZE 48
+#define ZF_ML_EXT          255
+#define ZF_EXT_SIZE        4
+#define ZF_LONG_OFFSET_MIN 1
+
+#define ZF_FLAG_INTERLEAVED   4
+#define ZF_BLOCK_LOG_MIN      4
+#define ZF_BLOCK_LOG_MAX      24
+#define ZF_BLOCK_LOG_DEFAULT  10     /* 8 KB of sequences, and their literals */
+
+#define ZF_FLAG_ABSOLUTE      8
+
+#define ZF_FLAG_INDEX         16
+#define ZF_CHECKPOINT_SIZE    24
+#define ZF_CHECKPOINT_LOG_MIN 4
+#define ZF_CHECKPOINT_LOG_MAX 24
+#define ZF_CHECKPOINT_LOG_DEFAULT 12   /* about 45 KB of output per checkpoint */
+
+#define ZF_LL_MAX          16
+#define ZF_ML_MAX          32
+#define ZF_OFFSET_MIN      32
+
+/* decoders copy literals and matches with fixed-size wildcopies :
+ * they may read up to ZF_LL_MAX bytes beyond the end of the frame,
+ * and write up to ZF_ML_MAX bytes beyond original_size,
+ * long and overlapping matches included.
+ * Frame and output buffers must be allocated with this margin. */
+#define ZF_WILDCOPY_MARGIN 32
+
+#endif  /* ZFFORMAT_H */
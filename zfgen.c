@@ -1,33 +1,31 @@
 /* Experimental long-range decoder
  * testing prefetching */
 
-/* format :
- * 4-bytes : original size
- * 4-bytes : compressed size (including header)
- * 4-bytes : nb sequences
- * Sequences : 6 bytes each : 1 - 1 - 4
- *             1 : literal length, required <= 16
- *             1 : match length, required <= 32
- *             4 : offset, required to stay within output buffer; must be >= 32
- * 16 MB : warm up data
- * Literals : remaining of compressed size
- *            note : sum of literal lengths must be >= nb literals
- *            Any literal left after last sequence is added to the block
- *
- * note : warmup data + sum of literal + sum of matches must be == original size
- */
+/* format : see zfformat.h */
 
 #include <stddef.h>   // size_t
 #include <stdlib.h>   // malloc, calloc
 #include <stdio.h>    // printf
+#include <string.h>   // memcpy
+#include <math.h>     // pow
 #include <assert.h>
 
+#include "zfformat.h"
 #include "zfgen.h"
+#include "zfdec.h"    // decompress, to checksum generated content
+#include "zfcrc.h"
 
 #define MB   * (1<<20)
-#define WARMUP_SIZE  (16 MB)
-#define SEQ_SIZE 6
-#define OFFSET_MIN 32
+#define GB   * (1ULL<<30)
+#define WARMUP_SIZE  ZF_V1_WARMUP_SIZE
+#define OFFSET_MIN   ZF_OFFSET_MIN
+#define LL_MAX       ZF_LL_MAX
+#define ML_MAX       ZF_ML_MAX
+#define NB_SEQS      (16 MB / ZF_V1_SEQ_SIZE)
+#define SEQ_LENGTH_AVG 11   /* literals + match, with default length distributions */
+
+#define MIN(a,b)   ((a) < (b) ? (a) : (b))
+#define MAX(a,b)   ((a) > (b) ? (a) : (b))
 
 
 
@@ -37,6 +35,120 @@ gen_params init_gen_params(void )
     params.cSize_max = 48 MB;
     params.offset_min = 14 MB;
     params.offset_max = 48 MB;
+    params.warmup_size = WARMUP_SIZE;
+    params.format_version = 0;
+    params.nb_sequences = 0;
+    params.silent = 0;
+    params.checksum = 0;
+    params.long_matches = 0;
+    params.absolute = 0;
+    params.checkpoint_log = 0;
+    params.independent = 0;
+    return gen_mix(params, 0);
+}
+
+/* generation buffer size : header, densest checkpoint index, sequences, warm up,
+ * worst case literals, extended lengths, and checksum */
+static size_t frameBound(size_t nbSeqs, size_t warmupSize)
+{
+    size_t const indexBound = ((nbSeqs >> ZF_CHECKPOINT_LOG_MIN) + 1) * ZF_CHECKPOINT_SIZE;
+    return ZF_V2_LONG_HEADER_SIZE + indexBound + nbSeqs * (ZF_V2_SEQ_SIZE + LL_MAX + ZF_EXT_SIZE) + warmupSize + ZF_CHECKSUM_SIZE + ZF_WILDCOPY_MARGIN;
+}
+
+gen_params gen_window(gen_params params, size_t windowSize)
+{
+    assert(windowSize > OFFSET_MIN);
+    params.offset_max = windowSize;
+    params.offset_min = MAX(windowSize / 48 * 14, OFFSET_MIN);   /* same proportion as default */
+    params.warmup_size = MAX(windowSize, (size_t)WARMUP_SIZE);
+    params.cSize_max = MAX(params.cSize_max, frameBound(NB_SEQS, params.warmup_size));
+    return params;
+}
+
+gen_params gen_smallFrame(gen_params params, size_t frameSize, size_t windowSize)
+{
+    assert(windowSize > OFFSET_MIN);
+    params.offset_max = windowSize;
+    params.offset_min = MAX(windowSize / 48 * 14, OFFSET_MIN);
+    params.warmup_size = windowSize;
+    params.nb_sequences = MAX(frameSize / SEQ_LENGTH_AVG, 1);
+    params.cSize_max = frameBound(params.nb_sequences, params.warmup_size);
+    return params;
+}
+
+
+/* offset mixes :
+ * short offsets stay within L1/L2 range, far offsets use params range,
+ * hot sets concentrate far references onto a few recurring positions */
+#define SHORT_OFFSET_MAX 16384
+
+static offset_regime regime(offset_distribution dist, int weight, size_t offset_min, size_t offset_max)
+{
+    offset_regime r;
+    r.distribution = dist;
+    r.weight = weight;
+    r.offset_min = offset_min;
+    r.offset_max = offset_max;
+    r.zipf_exponent = 1.0;
+    r.nb_hot_sources = 256;
+    return r;
+}
+
+static const char* const mixNames[GEN_NB_MIXES] = {
+    "far-uniform",
+    "periodic-1:4",
+    "random-1:4",
+    "zipf",
+    "hotset",
+    "zipf-hotset",
+};
+
+const char* gen_mixName(int mixId)
+{
+    assert(0 <= mixId && mixId < GEN_NB_MIXES);
+    return mixNames[mixId];
+}
+
+gen_params gen_mix(gen_params params, int mixId)
+{
+    offset_regime const shortOff = regime(ofd_uniform, 3, OFFSET_MIN, SHORT_OFFSET_MAX);
+    offset_regime const farOff = regime(ofd_uniform, 1, params.offset_min, params.offset_max);
+    assert(0 <= mixId && mixId < GEN_NB_MIXES);
+    params.periodic = 0;
+    switch (mixId) {
+    default:
+    case 0: /* far-uniform : worst case for the decoder */
+        params.nb_regimes = 1;
+        params.regimes[0] = farOff;
+        break;
+    case 1: /* periodic-1:4 : 3 short offsets, then 1 far */
+        params.periodic = 1;
+        params.nb_regimes = 2;
+        params.regimes[0] = shortOff;
+        params.regimes[1] = farOff;
+        break;
+    case 2: /* random-1:4 : 1 chance in 4 to select a far offset */
+        params.nb_regimes = 2;
+        params.regimes[0] = shortOff;
+        params.regimes[1] = farOff;
+        break;
+    case 3: /* zipf : mostly short offsets, with a long tail reaching the far range */
+        params.nb_regimes = 1;
+        params.regimes[0] = regime(ofd_zipf, 1, OFFSET_MIN, params.offset_max);
+        break;
+    case 4: /* hotset : most far references land onto 256 recurring sources */
+        params.nb_regimes = 3;
+        params.regimes[0] = regime(ofd_uniform, 6, OFFSET_MIN, SHORT_OFFSET_MAX);
+        params.regimes[1] = regime(ofd_hotset, 3, params.offset_min, params.offset_max);
+        params.regimes[2] = farOff;
+        break;
+    case 5: /* zipf-hotset : zipf background, plus hot far sources */
+        params.nb_regimes = 3;
+        params.regimes[0] = regime(ofd_zipf, 6, OFFSET_MIN, params.offset_max);
+        params.regimes[1] = regime(ofd_hotset, 3, params.offset_min, params.offset_max);
+        params.regimes[2] = farOff;
+        break;
+    }
     return params;
 }
 
@@ -81,78 +193,355 @@ int randomVal(int min, int max)
     return min + (key % (variation+1));
 }
 
+/* same as randomVal(), extended to 64-bit ranges */
+static size_t randomPos(size_t min, size_t max)
+{
+    assert(min <= max);
+    size_t const variation = max - min;
+    if (variation < (1U << 31)) {
+        unsigned key = (unsigned)rand() * PRIME32_1;
+        return min + (key % (variation+1));
+    }
+    {   unsigned const keyHigh = (unsigned)rand() * PRIME32_1;
+        unsigned const keyLow = (unsigned)rand() * PRIME32_2;
+        unsigned long long const key = ((unsigned long long)keyHigh << 32) + keyLow;
+        return min + (size_t)(key % ((unsigned long long)variation + 1));
+    }
+}
+
+/* uniform in ]0,1[ */
+static double randomUnit(void)
+{
+    return ((double)rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+/* rank r in [1, n], with probability ~ 1/r^s (continuous inversion) */
+static size_t randomZipf(size_t n, double s)
+{
+    double const u = randomUnit();
+    double r;
+    assert(n >= 1);
+    if (s > 0.999 && s < 1.001) {
+        r = pow((double)n + 1, u);
+    } else {
+        double const e = 1.0 - s;
+        r = pow((pow((double)n + 1, e) - 1.0) * u + 1.0, 1.0 / e);
+    }
+    if (r < 1) r = 1;
+    if (r > (double)n) r = (double)n;
+    return (size_t)r;
+}
+
 
 static void MEM_writeLE32(void* p, int val)
 {
     *(int*)p = val;
 }
 
+static void MEM_writeLE64(void* p, unsigned long long val)
+{
+    memcpy(p, &val, 8);
+}
+
+/* `ml` is the length byte : ZF_ML_EXT when the length is in the extension stream */
+static char* writeSeq(char* op, int ll, int ml, size_t offset, int version)
+{
+    *op++ = (char)ll;
+    *op++ = (char)ml;
+    if (version == 1) {
+        MEM_writeLE32(op, (int)offset);
+        return op + 4;
+    }
+    assert(offset <= ZF_V2_OFFSET_MAX);
+    {   unsigned long long const val = offset;
+        memcpy(op, &val, 6);   /* little endian */
+    }
+    return op + 6;
+}
 
-#define MIN(a,b)   ((a) < (b) ? (a) : (b))
-#define MAX(a,b)   ((a) > (b) ? (a) : (b))
+static size_t headerSize(int version, int flags)
+{
+    if (version == 1) return ZF_V1_HEADER_SIZE;
+    return (flags & ZF_FLAG_LONG_MATCHES) ? ZF_V2_LONG_HEADER_SIZE : ZF_V2_HEADER_SIZE;
+}
+
+static size_t seqSize(int version)
+{
+    return version == 1 ? ZF_V1_SEQ_SIZE : ZF_V2_SEQ_SIZE;
+}
+
+static void writeHeader(char* ostart, int version, int flags,
+                        size_t origSize, size_t cSize, size_t nbSeqs, size_t warmupSize, size_t extSize)
+{
+    if (version == 1) {
+        assert(flags == 0); (void)flags;
+        assert(origSize <= ZF_V1_SIZE_MAX && cSize <= ZF_V1_SIZE_MAX);
+        assert(warmupSize == WARMUP_SIZE); (void)warmupSize;
+        MEM_writeLE32(ostart, (int)origSize);
+        MEM_writeLE32(ostart + 4, (int)cSize);
+        MEM_writeLE32(ostart + 8, (int)nbSeqs);
+        return;
+    }
+    MEM_writeLE32(ostart, (int)ZF_MAGIC_V2);
+    ostart[4] = (char)version;
+    ostart[5] = (char)flags;
+    ostart[6] = ostart[7] = 0;
+    MEM_writeLE64(ostart + 8, origSize);
+    MEM_writeLE64(ostart + 16, cSize);
+    MEM_writeLE64(ostart + 24, nbSeqs);
+    MEM_writeLE64(ostart + 32, warmupSize);
+    if (flags & ZF_FLAG_LONG_MATCHES) MEM_writeLE64(ostart + 40, extSize);
+    else assert(extSize == 0);
+}
+
+/* version 1 whenever the frame fits */
+static int selectVersion(int requested, size_t origSizeMax, size_t offsetMax, size_t warmupSize)
+{
+    if (requested) return requested;
+    if (warmupSize == WARMUP_SIZE && origSizeMax <= ZF_V1_SIZE_MAX && offsetMax <= ZF_V1_SIZE_MAX) return 1;
+    return 2;
+}
+
+/* xorshift bytes : content must not be uniform, for its checksum to detect misplaced copies */
+static void fillRandom(void* buffer, size_t size)
+{
+    unsigned char* const p = buffer;
+    unsigned long long state = 0x9E3779B185EBCA87ULL;
+    for (size_t n=0; n < size; n++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        p[n] = (unsigned char)(state >> 32);
+    }
+}
+
+/* decodes frame, header complete, except its checksum trailer,
+ * @return : checksum of its content, warm up data excluded */
+static unsigned contentChecksum(const char* frame, size_t cSize)
+{
+    frame_header const h = read_header(frame, cSize);
+    size_t const origSize = h.original_size;
+    size_t const warmupSize = h.warmup_size;
+    char* const dst = malloc(origSize + ZF_WILDCOPY_MARGIN); assert(dst != NULL);
+    memcpy(dst, frame_warmup(frame, h), warmupSize);
+    {   size_t const dSize = decompress(dst, origSize + ZF_WILDCOPY_MARGIN, frame, cSize);
+        assert(dSize == origSize - warmupSize); (void)dSize;
+    }
+    {   unsigned const checksum = crc32c(dst + warmupSize, origSize - warmupSize);
+        free(dst);
+        return checksum;
+    }
+}
 
 typedef struct {
-    int offset_min;
-    int offset_max;
-} offset_limit;
+    offset_regime def;
+    size_t* hot_pos;   // ofd_hotset : current absolute position of each hot source
+} regime_state;
+
+#define OFL_TABLE_SIZE 64
+
+/* long matches mix : one sequence in LONG_MATCH_RATE gets a match longer than ML_MAX, log-uniform up to LONG_MATCH_MAX,
+ * one in SHORT_RUN_RATE of the others replicates a pattern of less than OFFSET_MIN bytes, up to SHORT_RUN_MAX */
+#define LONG_MATCH_RATE  64
+#define LONG_MATCH_MAX   4096
+#define SHORT_RUN_RATE   16
+#define SHORT_RUN_MAX    256
+#define HOT_POS_NONE   ((size_t)-1)
+
+static const char* distName(offset_distribution dist)
+{
+    switch (dist) {
+    case ofd_zipf: return "zipf";
+    case ofd_hotset: return "hotset";
+    case ofd_uniform:
+    default: return "uniform";
+    }
+}
+
+/* select offset for a match starting at position `matchPos`,
+ * with `histSize` bytes of history available before its literals */
+static size_t gen_offset(regime_state* rs, size_t histSize, size_t matchPos)
+{
+    offset_regime const* const r = &rs->def;
+    assert(histSize > r->offset_min);
+    size_t const offmax = MIN(r->offset_max, histSize);
+    switch (r->distribution) {
+    case ofd_zipf:
+        return r->offset_min - 1 + randomZipf(offmax - r->offset_min + 1, r->zipf_exponent);
+    case ofd_hotset:
+        {   int const h = randomVal(0, r->nb_hot_sources - 1);
+            size_t offset = matchPos - rs->hot_pos[h];
+            if (rs->hot_pos[h] == HOT_POS_NONE || offset < r->offset_min || offset > offmax) {
+                /* source out of range (or not yet placed) : relocate it */
+                offset = randomPos(r->offset_min, offmax);
+                rs->hot_pos[h] = matchPos - offset;
+            }
+            return offset;
+        }
+    case ofd_uniform:
+    default:
+        return randomPos(r->offset_min, offmax);
+    }
+}
+
+/* independent segments : a source reaching output of previous segments
+ * is moved into warm up data, which decoders always have, at least ZF_OFFSET_MIN before its match */
+static size_t foldSource(size_t srcPos, size_t ml, size_t warmupSize)
+{
+    size_t const span = warmupSize - MAX(ml, (size_t)OFFSET_MIN);
+    assert(warmupSize > MAX(ml, (size_t)OFFSET_MIN));
+    return srcPos % span;
+}
 
 buff generate(gen_params params)
 {
-    assert(params.cSize_max > 16 MB);
-    void* const outBuff = calloc(1, params.cSize_max); assert(outBuff != NULL);
+    if (params.nb_regimes == 0) {
+        params.nb_regimes = 1;
+        params.regimes[0] = (offset_regime){ ofd_uniform, 1, params.offset_min, params.offset_max, 1.0, 0 };
+    }
+    assert(0 < params.nb_regimes && params.nb_regimes <= GEN_REGIMES_MAX);
+    regime_state rstate[GEN_REGIMES_MAX];
+    int totalWeight = 0;
+    size_t offsetMax = 0;
+    for (int r=0; r < params.nb_regimes; r++) {
+        offset_regime def = params.regimes[r];
+        def.offset_min = MAX(def.offset_min, OFFSET_MIN);
+        assert(def.offset_min <= def.offset_max);
+        assert(def.weight > 0);
+        rstate[r].def = def;
+        rstate[r].hot_pos = NULL;
+        if (def.distribution == ofd_hotset) {
+            assert(def.nb_hot_sources > 0);
+            rstate[r].hot_pos = malloc(def.nb_hot_sources * sizeof(size_t)); assert(rstate[r].hot_pos != NULL);
+            for (int h=0; h < def.nb_hot_sources; h++) rstate[r].hot_pos[h] = HOT_POS_NONE;
+        }
+        totalWeight += def.weight;
+        offsetMax = MAX(offsetMax, def.offset_max);
+        if (!params.silent)
+            printf("regime %i : %-7s offsets between %zu and %zu, weight %i \n",
+                    r, distName(def.distribution), def.offset_min, def.offset_max, def.weight);
+    }
 
-#define OFL_ROUND 1
-#define OFL_TABLE_SIZE 8
-static_assert(OFL_TABLE_SIZE >= OFL_ROUND, "");
-    offset_limit ofl_table[OFL_TABLE_SIZE];
-    offset_limit const short_offset = { OFFSET_MIN, 16384 };
-    for (int i=0; i < OFL_TABLE_SIZE; i++)
-        ofl_table[i] = short_offset;
-    ofl_table[0] = (offset_limit){ MAX(params.offset_min, OFFSET_MIN) , params.offset_max };
-    printf("using offset distances between %i and %i, with a period of %i \n",
-            ofl_table[0].offset_min, ofl_table[0].offset_max, OFL_ROUND);
+    /* periodic mode : regimes follow a fixed pattern, of length totalWeight */
+    int ofl_table[OFL_TABLE_SIZE];
+    int const ofl_round = params.periodic ? totalWeight : 1;
+    assert(ofl_round <= OFL_TABLE_SIZE);
+    {   int n = 0;
+        for (int r=0; r < params.nb_regimes; r++)
+            for (int w=0; w < rstate[r].def.weight && n < OFL_TABLE_SIZE; w++)
+                ofl_table[n++] = r;
+    }
+    if (!params.silent)
+        printf("offset regimes selected %s \n",
+                params.nb_regimes == 1 ? "constantly" : (params.periodic ? "periodically" : "randomly"));
+
+    size_t const nbSeqMax = params.nb_sequences ? params.nb_sequences : NB_SEQS;
+    int const version = (params.checksum || params.long_matches || params.absolute || params.checkpoint_log) ? 2 :
+                        selectVersion(params.format_version,
+                                      params.warmup_size + nbSeqMax * (LL_MAX + ML_MAX),
+                                      offsetMax, params.warmup_size);
+    int const flags = (params.checksum ? ZF_FLAG_CHECKSUM : 0)
+                    | (params.long_matches ? ZF_FLAG_LONG_MATCHES : 0)
+                    | (params.absolute ? ZF_FLAG_ABSOLUTE : 0)
+                    | (params.checkpoint_log ? ZF_FLAG_INDEX : 0);
+    assert(params.cSize_max > params.warmup_size);
+    void* const outBuff = calloc(1, params.cSize_max); assert(outBuff != NULL);
+    unsigned* const extLengths = params.long_matches ? malloc(nbSeqMax * sizeof(unsigned)) : NULL;
+    assert(!params.long_matches || extLengths != NULL);
+    size_t nbExt = 0;
 
+    /* checkpoint index : follows header, filled along sequences */
+    size_t const checkpointSeqs = params.checkpoint_log ? (size_t)1 << params.checkpoint_log : 0;
+    size_t const indexSize = checkpointSeqs ? (nbSeqMax + checkpointSeqs - 1) / checkpointSeqs * ZF_CHECKPOINT_SIZE : 0;
+    assert(!params.checkpoint_log || (ZF_CHECKPOINT_LOG_MIN <= params.checkpoint_log && params.checkpoint_log <= ZF_CHECKPOINT_LOG_MAX));
 
     char* const ostart = outBuff;
-    char* op = ostart;
-    int* origSizePtr = (void*)op; op+=4;
-    int* cSizePtr = (void*)op; op+=4;
-    int* nbSeqPtr = (void*)op; op+=4;
+    char* const indexStart = ostart + headerSize(version, flags);
+    char* op = indexStart + indexSize;
 
-    int origSize = WARMUP_SIZE;
-    int cSize = 4 + 4 + 4;
-    int litSize = 0;
+    size_t origSize = params.warmup_size;
+    size_t segStart = origSize;   /* output position of current checkpoint */
+    size_t cSize = headerSize(version, flags) + indexSize;
+    size_t litSize = 0;
 
-    int const nbSeqMax = 16 MB / SEQ_SIZE;
     int offset_id = 0;
-    for (int seqNb = 0; seqNb < nbSeqMax; seqNb++) {
+    for (size_t seqNb = 0; seqNb < nbSeqMax; seqNb++) {
+        if (checkpointSeqs && seqNb % checkpointSeqs == 0) {
+            char* const entry = indexStart + seqNb / checkpointSeqs * ZF_CHECKPOINT_SIZE;
+            MEM_writeLE64(entry, origSize);
+            MEM_writeLE64(entry + 8, litSize);
+            MEM_writeLE64(entry + 16, nbExt * ZF_EXT_SIZE);
+            segStart = origSize;
+        }
         int ll = gen_d50_0_16();
-        int ml = gen_d12_3_32();
+        size_t ml = gen_d12_3_32();
         assert(ml <= 32);
-        *op++ = (char)ll;
-        *op++ = (char)ml;
 
         // offset
-        offset_limit ofl = ofl_table[offset_id]; offset_id = (offset_id + 1) % OFL_ROUND;
-        assert(origSize > ofl.offset_min);
-        int const offmax = MIN(ofl.offset_max, origSize);
-        int const offset = randomVal(ofl.offset_min, offmax);
-        MEM_writeLE32(op, offset); op+=4;
+        int regimeId;
+        if (params.nb_regimes == 1) {
+            regimeId = 0;
+        } else if (params.periodic) {
+            regimeId = ofl_table[offset_id]; offset_id = (offset_id + 1) % ofl_round;
+        } else {
+            int pick = randomVal(0, totalWeight - 1);
+            regimeId = 0;
+            while (pick >= rstate[regimeId].def.weight) pick -= rstate[regimeId].def.weight, regimeId++;
+        }
+        size_t offset = gen_offset(&rstate[regimeId], origSize, origSize + ll);
+
+        if (params.long_matches) {
+            if (randomVal(0, LONG_MATCH_RATE - 1) == 0) {
+                ml = (size_t)((ML_MAX + 1) * pow((double)LONG_MATCH_MAX / (ML_MAX + 1), randomUnit()));
+            } else if (randomVal(0, SHORT_RUN_RATE - 1) == 0) {
+                offset = (size_t)randomVal(ZF_LONG_OFFSET_MIN, OFFSET_MIN - 1);
+                ml = (size_t)randomVal(4, SHORT_RUN_MAX);
+            }
+        }
+        if (params.independent && checkpointSeqs) {
+            size_t const matchPos = origSize + ll;
+            size_t const srcPos = matchPos - offset;
+            if (srcPos < segStart && srcPos + ml > params.warmup_size)
+                offset = matchPos - foldSource(srcPos, ml, params.warmup_size);
+        }
+        if (params.absolute) offset = origSize + ll - offset;   /* source position */
+        if (ml >= ZF_ML_EXT) {
+            extLengths[nbExt++] = (unsigned)ml;
+            op = writeSeq(op, ll, ZF_ML_EXT, offset, version);
+        } else {
+            op = writeSeq(op, ll, (int)ml, offset, version);
+        }
 
         origSize += ll + ml;
-        cSize += ll + SEQ_SIZE;
+        cSize += ll + seqSize(version);
         litSize += ll;
     }
 
-    // add warmup, then literals
-    op += WARMUP_SIZE;
-    cSize += WARMUP_SIZE;
-    assert(cSize < params.cSize_max);
+    // add warmup, then literals, then extended lengths
+    if (params.checksum) fillRandom(op, params.warmup_size + litSize);
+    op += params.warmup_size;
+    cSize += params.warmup_size;
     op += litSize;
+    for (size_t n=0; n < nbExt; n++) {
+        MEM_writeLE32(op, (int)extLengths[n]);
+        op += ZF_EXT_SIZE;
+    }
+    cSize += nbExt * ZF_EXT_SIZE;
+    free(extLengths);
+
+    if (params.checksum) cSize += ZF_CHECKSUM_SIZE;
+    assert(cSize + ZF_WILDCOPY_MARGIN <= params.cSize_max);
+    writeHeader(ostart, version, flags, origSize, cSize, nbSeqMax, params.warmup_size, nbExt * ZF_EXT_SIZE);
+    if (checkpointSeqs) ostart[7] = (char)params.checkpoint_log;
+    if (params.checksum) {
+        MEM_writeLE32(op, (int)contentChecksum(ostart, cSize));
+        op += ZF_CHECKSUM_SIZE;
+    }
+    if (!params.silent && params.long_matches)
+        printf("long matches : %zu extended lengths, up to %i, and runs at offsets below %i \n",
+                nbExt, LONG_MATCH_MAX, OFFSET_MIN);
 
-    MEM_writeLE32(origSizePtr, origSize);
-    MEM_writeLE32(cSizePtr, cSize);
-    MEM_writeLE32(nbSeqPtr, nbSeqMax);
+    for (int r=0; r < params.nb_regimes; r++) free(rstate[r].hot_pos);
 
     buff result = { .buffer = outBuff,
                     .size = op - (char*)outBuff
@@ -160,6 +549,167 @@ static_assert(OFL_TABLE_SIZE >= OFL_ROUND, "");
     return result;
 }
 
+/* number of format sequences needed to represent `seq` */
+static size_t nbSplitSeqs(zf_seq seq)
+{
+    size_t const nbLitSeqs = seq.ll ? (seq.ll - 1) / LL_MAX : 0;           /* literals-only sequences before last one */
+    size_t const nbMatchSeqs = seq.ml ? (seq.ml - 1) / ML_MAX + 1 : 1;     /* last literals share first match */
+    return nbLitSeqs + nbMatchSeqs;
+}
+
+buff build_frame(const zf_seq* seqs, size_t nbSeqs)
+{
+    buff const error = { NULL, 0 };
+    size_t nbFrameSeqs = 0;
+    size_t litSize = 0;
+    size_t matchSize = 0;
+    size_t offsetMax = 0;
+    for (size_t n=0; n < nbSeqs; n++) {
+        nbFrameSeqs += nbSplitSeqs(seqs[n]);
+        litSize += seqs[n].ll;
+        matchSize += seqs[n].ml;
+        offsetMax = MAX(offsetMax, seqs[n].offset);
+    }
+    size_t const origSize = WARMUP_SIZE + litSize + matchSize;
+    int const version = selectVersion(0, origSize, offsetMax, WARMUP_SIZE);
+    size_t const cSize = headerSize(version, 0) + nbFrameSeqs * seqSize(version) + WARMUP_SIZE + litSize;
+    if (version == 1 && cSize > ZF_V1_SIZE_MAX) return error;
+
+    char* const outBuff = calloc(1, cSize + ZF_WILDCOPY_MARGIN);
+    if (outBuff == NULL) return error;
+
+    char* op = outBuff + headerSize(version, 0);
+    size_t pos = WARMUP_SIZE;
+    size_t nbRaised = 0, nbClamped = 0;
+    for (size_t n=0; n < nbSeqs; n++) {
+        unsigned ll = seqs[n].ll;
+        unsigned ml = seqs[n].ml;
+        /* long literal runs : literals-only sequences, with a dummy short offset */
+        while (ll > LL_MAX) {
+            op = writeSeq(op, LL_MAX, 0, OFFSET_MIN, version);
+            ll -= LL_MAX;
+            pos += LL_MAX;
+        }
+        pos += ll;
+
+        size_t offset = seqs[n].offset;
+        if (offset < OFFSET_MIN) { offset = OFFSET_MIN; nbRaised++; }
+        if (offset > pos) { offset = pos; nbClamped++; }
+
+        /* long matches : continue from same offset, which is >= ML_MAX */
+        do {
+            unsigned const mlChunk = MIN(ml, ML_MAX);
+            op = writeSeq(op, (int)ll, (int)mlChunk, offset, version);
+            ll = 0;
+            ml -= mlChunk;
+            pos += mlChunk;
+        } while (ml > 0);
+    }
+    assert(pos == origSize);
+    assert((size_t)(op - outBuff) == headerSize(version, 0) + nbFrameSeqs * seqSize(version));
+    printf("trace : %zu sequences => %zu frame sequences (%zu offsets raised to %i, %zu clamped to history) \n",
+            nbSeqs, nbFrameSeqs, nbRaised, OFFSET_MIN, nbClamped);
+
+    writeHeader(outBuff, version, 0, origSize, cSize, nbFrameSeqs, WARMUP_SIZE, 0);
+
+    buff result = { .buffer = outBuff,
+                    .size = cSize
+                  };
+    return result;
+}
+
+static size_t readSeqOffset(const char* seqPtr, unsigned version)
+{
+    unsigned long long offset = 0;
+    memcpy(&offset, seqPtr + 2, version == 1 ? 4 : 6);   /* little endian */
+    return (size_t)offset;
+}
+
+buff interleave_frame(buff frame, int blockLog)
+{
+    frame_header const h = read_header(frame.buffer, frame.size);
+    int const flags = (int)h.flags | (blockLog ? ZF_FLAG_INTERLEAVED : 0);
+    size_t const blockSeqs = blockLog ? (size_t)1 << blockLog : h.nb_sequences;
+    size_t const sectionsSize = h.compressed_size - h.header_size - h.nb_sequences * h.seq_size;   /* warm up, literals, trailers */
+    size_t const cSize = headerSize(2, flags) + h.nb_sequences * ZF_V2_SEQ_SIZE + sectionsSize;
+    const char* const litEnd = (const char*)frame.buffer + frame.size - h.extension_size - h.checksum_size;
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(frame.buffer, h, &litPtr);
+    assert(blockLog == 0 || (ZF_BLOCK_LOG_MIN <= blockLog && blockLog <= ZF_BLOCK_LOG_MAX));
+    assert(!h.block_seqs && !h.index_size);
+    assert(frame.size == h.compressed_size);
+
+    char* const outBuff = calloc(1, cSize + ZF_WILDCOPY_MARGIN); assert(outBuff != NULL);
+    writeHeader(outBuff, 2, flags, h.original_size, cSize, h.nb_sequences, h.warmup_size, h.extension_size);
+    outBuff[6] = (char)blockLog;
+
+    char* op = outBuff + headerSize(2, flags);
+    if (!blockLog) {
+        /* single section : sequences, then warm up data, literals and trailers, unchanged */
+        for (size_t n = 0; n < h.nb_sequences; n++, seqPtr += h.seq_size)
+            op = writeSeq(op, (unsigned char)seqPtr[0], (unsigned char)seqPtr[1], readSeqOffset(seqPtr, h.version), 2);
+        memcpy(op, seqPtr, (size_t)((const char*)frame.buffer + frame.size - seqPtr));
+        buff result = { .buffer = outBuff,
+                        .size = cSize
+                      };
+        return result;
+    }
+    memcpy(op, frame_warmup(frame.buffer, h), h.warmup_size);
+    op += h.warmup_size;
+    for (size_t seqNb = 0; seqNb < h.nb_sequences; ) {
+        size_t const nbBlockSeqs = MIN(blockSeqs, h.nb_sequences - seqNb);
+        size_t litSize = 0;
+        for (size_t n = 0; n < nbBlockSeqs; n++, seqPtr += h.seq_size) {
+            op = writeSeq(op, (unsigned char)seqPtr[0], (unsigned char)seqPtr[1], readSeqOffset(seqPtr, h.version), 2);
+            litSize += (unsigned char)seqPtr[0];
+        }
+        seqNb += nbBlockSeqs;
+        if (seqNb == h.nb_sequences) litSize = (size_t)(litEnd - litPtr);   /* last block : literals after last sequence too */
+        memcpy(op, litPtr, litSize);
+        op += litSize;
+        litPtr += litSize;
+    }
+    /* remaining literals of frames without sequences, then extension stream and checksum, unchanged */
+    memcpy(op, litPtr, (size_t)((const char*)frame.buffer + frame.size - litPtr));
+    op += (const char*)frame.buffer + frame.size - litPtr;
+    assert((size_t)(op - outBuff) == cSize);
+
+    buff result = { .buffer = outBuff,
+                    .size = cSize
+                  };
+    return result;
+}
+
+buff absolute_frame(buff frame)
+{
+    buff const result = interleave_frame(frame, 0);   /* version 2 copy */
+    frame_header const h = read_header(result.buffer, result.size);
+    char* seqPtr = (char*)result.buffer + h.header_size;
+    const char* extPtr = (const char*)result.buffer + result.size - h.checksum_size - h.extension_size;
+    size_t pos = h.warmup_size;
+    assert(!(h.flags & ZF_FLAG_ABSOLUTE));
+
+    ((char*)result.buffer)[5] = (char)(h.flags | ZF_FLAG_ABSOLUTE);
+    for (size_t n = 0; n < h.nb_sequences; n++) {
+        int const ll = (unsigned char)seqPtr[0];
+        int const mlByte = (unsigned char)seqPtr[1];
+        size_t const offset = readSeqOffset(seqPtr, 2);
+        size_t ml = (size_t)mlByte;
+        if ((h.flags & ZF_FLAG_LONG_MATCHES) && mlByte == ZF_ML_EXT) {
+            unsigned extended;
+            memcpy(&extended, extPtr, sizeof(extended));
+            extPtr += ZF_EXT_SIZE;
+            ml = extended;
+        }
+        pos += (size_t)ll;
+        assert(0 < offset && offset <= pos);
+        seqPtr = writeSeq(seqPtr, ll, mlByte, pos - offset, 2);
+        pos += ml;
+    }
+    assert(pos <= h.original_size);   /* last literals follow */
+    return result;
+}
+
 void free_buff(buff buffer)
 {
     free(buffer.buffer);
@@ -1,3 +1,6 @@
+#ifndef ZFGEN_H
+#define ZFGEN_H
+
 #include <stddef.h>   // size_t
 
 typedef struct {
@@ -5,14 +8,94 @@ typedef struct {
     size_t size;
 } buff;
 
+typedef enum {
+    ofd_uniform,   // offsets uniformly distributed between offset_min and offset_max
+    ofd_zipf,      // offset rank r (from offset_min) drawn with probability ~ 1/r^zipf_exponent
+    ofd_hotset     // offsets point into a small set of recurring source positions
+} offset_distribution;
+
 typedef struct {
-    size_t cSize_max;  // must be > 16 MB
-    int offset_min;
-    int offset_max;
+    offset_distribution distribution;
+    int weight;             // relative share of sequences using this regime
+    size_t offset_min;
+    size_t offset_max;
+    double zipf_exponent;   // ofd_zipf only
+    int nb_hot_sources;     // ofd_hotset only
+} offset_regime;
+
+#define GEN_REGIMES_MAX 8
+
+typedef struct {
+    size_t cSize_max;      // generation buffer size, must be > warmup_size
+    size_t offset_min;     // far offset range, used by gen_mix()
+    size_t offset_max;
+    size_t warmup_size;    // history preceding first sequence, 16 MB by default
+    int format_version;    // 0 : automatic, version 1 whenever frame fits, version 2 otherwise
+    size_t nb_sequences;   // 0 : default, 16 MB worth of version 1 sequences
+    int silent;            // 1 : do not describe regimes while generating
+    int checksum;          // 1 : random content, followed by its checksum; forces version 2
+    int long_matches;      // 1 : add long matches, and runs at offsets < ZF_OFFSET_MIN (ZF_FLAG_LONG_MATCHES); forces version 2
+    int absolute;          // 1 : sequences store match source positions (ZF_FLAG_ABSOLUTE); forces version 2
+    int checkpoint_log;    // > 0 : checkpoint index, every 2^checkpoint_log sequences (ZF_FLAG_INDEX); forces version 2
+    int independent;       // 1 : with an index, match sources stay within their segment or warm up data
+    int periodic;      // 1 : regimes follow each other in a fixed pattern, following weights
+                       // 0 : each sequence selects its regime randomly, proportionally to weights
+    int nb_regimes;    // 0 : single uniform regime, between offset_min and offset_max
+    offset_regime regimes[GEN_REGIMES_MAX];
 } gen_params;
 
 gen_params init_gen_params();
 
+/* gen_window() :
+ * set far offset range up to `windowSize`,
+ * with warm up data large enough to let offsets reach that far from first sequence.
+ * generation buffer is enlarged accordingly.
+ * apply gen_mix() afterwards to propagate the new range into regimes */
+gen_params gen_window(gen_params params, size_t windowSize);
+
+/* gen_smallFrame() :
+ * frame decoding approximately `frameSize` bytes,
+ * with offsets reaching up to `windowSize`, which is also the size of warm up data.
+ * apply gen_mix() afterwards to propagate the new range into regimes */
+gen_params gen_smallFrame(gen_params params, size_t frameSize, size_t windowSize);
+
+/* gen_mix() :
+ * replace regimes of `params` by preset offset mix `mixId` (< GEN_NB_MIXES).
+ * far regimes use range [params.offset_min, params.offset_max].
+ * mix 0 is the default : uniform far offsets only */
+#define GEN_NB_MIXES 6
+gen_params gen_mix(gen_params params, int mixId);
+const char* gen_mixName(int mixId);
+
 buff generate(gen_params params);
 
+/* build_frame() :
+ * build a valid frame from a list of sequences, typically imported from a trace.
+ * literals and warm up data are synthesized.
+ * sequences exceeding format limits are adapted :
+ * long literal runs and long matches are split into several sequences,
+ * offsets are raised to the format minimum, or clamped to available history.
+ * @return : frame, or .buffer==NULL if it cannot be represented */
+typedef struct {
+    unsigned ll;
+    unsigned ml;
+    unsigned offset;
+} zf_seq;
+
+buff build_frame(const zf_seq* seqs, size_t nbSeqs);
+
+/* interleave_frame() :
+ * same content as `frame`, with sequences and literals interleaved in blocks of (1 << blockLog) sequences,
+ * see ZF_FLAG_INTERLEAVED. blockLog 0 : single section, same layout as `frame`.
+ * result is always version 2. `frame` must be neither interleaved already nor indexed; it is left unchanged */
+buff interleave_frame(buff frame, int blockLog);
+
+/* absolute_frame() :
+ * same content as `frame`, with offsets replaced by match source positions, see ZF_FLAG_ABSOLUTE.
+ * result is version 2, single section : interleave it afterwards if needed.
+ * `frame` must be neither interleaved, absolute already, nor indexed; it is left unchanged */
+buff absolute_frame(buff frame);
+
 void free_buff(buff buffer);
+
+#endif  /* ZFGEN_H */
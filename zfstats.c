@@ -0,0 +1,416 @@
+/* Frame analytics,
+ * see zfstats.h for definitions */
+
+#include <stddef.h>   // size_t
+#include <stdlib.h>   // calloc, free
+#include <string.h>   // memcpy, memset
+#include <math.h>     // log2
+#include <assert.h>
+
+#include "zfformat.h"
+#include "zfstats.h"
+
+
+int analysis_bin(unsigned long long value)
+{
+    int bin = 0;
+    while (value) { bin++; value >>= 1; }
+    assert(bin < ANALYSIS_LOG_BINS);
+    return bin;
+}
+
+/* extension stream of frames with long matches, NULL otherwise */
+static const char* extensionStream(frame_header h, const void* src, size_t srcSize)
+{
+    if (!(h.flags & ZF_FLAG_LONG_MATCHES)) return NULL;
+    return (const char*)src + srcSize - h.checksum_size - h.extension_size;
+}
+
+/* advances `*extPtr` on extended lengths */
+static size_t readMatchLength(const char* seqPtr, const char** extPtr)
+{
+    size_t const ml = (size_t)(unsigned char)seqPtr[1];
+    if (*extPtr != NULL && ml == ZF_ML_EXT) {
+        unsigned val;
+        memcpy(&val, *extPtr, sizeof(val));
+        *extPtr += ZF_EXT_SIZE;
+        return val;
+    }
+    return ml;
+}
+
+/* interleaved frames : when `seqNb` sequences done complete a block,
+ * next block starts where literals of this one end */
+static void nextBlock(frame_header h, size_t seqNb, const char** seqPtr, const char** litPtr)
+{
+    size_t nbBlockSeqs;
+    if (!h.block_seqs || seqNb % h.block_seqs || seqNb >= h.nb_sequences) return;
+    nbBlockSeqs = h.nb_sequences - seqNb < h.block_seqs ? h.nb_sequences - seqNb : h.block_seqs;
+    *seqPtr = *litPtr;
+    *litPtr = *seqPtr + nbBlockSeqs * h.seq_size;
+}
+
+
+/* Reuse distances :
+ * each access gets a timestamp, lastAccess[] keeps latest timestamp of each line,
+ * and a Fenwick tree marks timestamps which are the latest access of their line.
+ * Distinct lines accessed since previous access of a line
+ * = nb of marks after its previous timestamp */
+
+typedef struct {
+    unsigned* lastAccess;   /* per line; 0 : never accessed */
+    unsigned* tree;         /* Fenwick tree over timestamps, 1-based */
+    size_t treeSize;
+    unsigned now;
+    frame_analysis* fa;
+    /* distinct pages per block */
+    unsigned* pageStamps;
+    unsigned block;         /* 1-based */
+    size_t blockPages;
+} reuse_state;
+
+static void tree_add(reuse_state* rs, size_t pos, int delta)
+{
+    for ( ; pos <= rs->treeSize; pos += pos & (~pos + 1)) rs->tree[pos] += (unsigned)delta;
+}
+
+static size_t tree_sum(const reuse_state* rs, size_t pos)
+{
+    size_t sum = 0;
+    for ( ; pos > 0; pos -= pos & (~pos + 1)) sum += rs->tree[pos];
+    return sum;
+}
+
+static void touchPage(reuse_state* rs, size_t address)
+{
+    size_t const page = address / ANALYSIS_PAGE_SIZE;
+    if (rs->pageStamps[page] != rs->block) {
+        rs->pageStamps[page] = rs->block;
+        rs->blockPages++;
+    }
+}
+
+/* isRead : match source, its distance is recorded */
+static void touchLine(reuse_state* rs, size_t line, int isRead)
+{
+    unsigned const t = ++rs->now;
+    unsigned const last = rs->lastAccess[line];
+    assert(t <= rs->treeSize);
+    if (last) {
+        if (isRead) {
+            size_t const distance = tree_sum(rs, t - 1) - tree_sum(rs, last);
+            rs->fa->reuse_hist[analysis_bin(distance)]++;
+        }
+        tree_add(rs, last, -1);
+    } else if (isRead) {
+        rs->fa->reuse_cold++;
+    }
+    tree_add(rs, t, +1);
+    rs->lastAccess[line] = t;
+    rs->fa->nb_source_lines += (size_t)isRead;
+}
+
+static void accessRange(reuse_state* rs, size_t start, size_t length, int isRead)
+{
+    size_t line;
+    if (length == 0) return;
+    for (line = start / ANALYSIS_LINE_SIZE; line <= (start + length - 1) / ANALYSIS_LINE_SIZE; line++)
+        touchLine(rs, line, isRead);
+    touchPage(rs, start);
+    touchPage(rs, start + length - 1);
+}
+
+
+frame_analysis analyze_frame(const void* src, size_t srcSize)
+{
+    frame_analysis fa;
+    frame_header const h = read_header(src, srcSize);
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    size_t const nbSeqs = h.nb_sequences;
+    size_t const nbLines = h.original_size / ANALYSIS_LINE_SIZE + 1;
+    size_t const nbPages = h.original_size / ANALYSIS_PAGE_SIZE + 1;
+    size_t pos = h.warmup_size;
+    size_t pagesTotal = 0;
+    const char* extPtr = extensionStream(h, src, srcSize);
+    reuse_state rs;
+
+    memset(&fa, 0, sizeof(fa));
+    fa.basic = collect_stats(src, srcSize);
+
+    /* one timestamp per line touched : 3 accesses per sequence (literals, match source, match output),
+     * each at most 32 bytes, i.e. 2 lines, unaligned.
+     * long matches : source and output span up to their length in lines, beyond these 2 */
+    memset(&rs, 0, sizeof(rs));
+    rs.treeSize = 6 * nbSeqs + (extPtr ? 2 * nbLines : 0) + 1;
+    rs.lastAccess = calloc(nbLines, sizeof(unsigned));
+    rs.tree = calloc(rs.treeSize + 1, sizeof(unsigned));
+    rs.pageStamps = calloc(nbPages, sizeof(unsigned));
+    assert(rs.lastAccess != NULL && rs.tree != NULL && rs.pageStamps != NULL);
+    assert(rs.treeSize < (unsigned)-1);
+    rs.fa = &fa;
+    rs.block = 1;
+
+    for (size_t seqNb = 0; seqNb < nbSeqs; seqNb++) {
+        size_t const ll = (size_t)(unsigned char)seqPtr[0];
+        size_t const ml = readMatchLength(seqPtr, &extPtr);
+        size_t const offset = match_offset(h, seqPtr, pos + ll);
+        seqPtr += h.seq_size;
+        litPtr += ll;
+        nextBlock(h, seqNb + 1, &seqPtr, &litPtr);
+
+        fa.ll_hist[analysis_bin(ll)]++;
+        fa.ml_hist[analysis_bin(ml)]++;
+
+        accessRange(&rs, pos, ll, 0);
+        pos += ll;
+        if (ml > 0) {
+            size_t const matchPos = pos - offset;
+            assert(offset <= pos);
+            fa.nb_matches++;
+            fa.offset_hist[analysis_bin(offset)]++;
+            fa.line_crossings += (matchPos % ANALYSIS_LINE_SIZE) + ml > ANALYSIS_LINE_SIZE;
+            fa.page_crossings += (matchPos % ANALYSIS_PAGE_SIZE) + ml > ANALYSIS_PAGE_SIZE;
+            accessRange(&rs, matchPos, ml, 1);
+            accessRange(&rs, pos, ml, 0);
+            pos += ml;
+        }
+
+        if ((seqNb + 1) % ANALYSIS_PAGES_BLOCK == 0) {
+            pagesTotal += rs.blockPages;
+            fa.nb_page_blocks++;
+            rs.blockPages = 0;
+            rs.block++;
+        }
+    }
+
+    fa.pages_per_block = fa.nb_page_blocks ? (double)pagesTotal / fa.nb_page_blocks : (double)rs.blockPages;
+
+    free(rs.pageStamps);
+    free(rs.tree);
+    free(rs.lastAccess);
+    return fa;
+}
+
+
+/* Cache simulation */
+
+static const char* const streamNames[SIM_NB_STREAMS] = { "sequences", "literals", "matches", "output" };
+
+const char* simulate_streamName(sim_stream_e stream)
+{
+    if ((unsigned)stream >= SIM_NB_STREAMS) return "unknown";
+    return streamNames[stream];
+}
+
+#define SIM_BUFFER_ALIGN ((unsigned long long)2 << 20)
+
+void simulate_frame(CSIM_t* sim, const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    const char* const istart = (const char*)src;
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    size_t const nbSeqs = h.nb_sequences;
+    /* src at address 0, dst in the next aligned region */
+    unsigned long long const dstBase = (srcSize / SIM_BUFFER_ALIGN + 1) * SIM_BUFFER_ALIGN;
+    unsigned long long op = dstBase + h.warmup_size;
+    const char* extPtr = extensionStream(h, src, srcSize);
+
+    assert(SIM_NB_STREAMS <= CSIM_TAGS_MAX);
+    for (size_t seqNb = 0; seqNb < nbSeqs; seqNb++) {
+        size_t const ll = (size_t)(unsigned char)seqPtr[0];
+        size_t const ml = readMatchLength(seqPtr, &extPtr);
+        size_t const offset = match_offset(h, seqPtr, (size_t)(op - dstBase) + ll);
+
+        CSIM_access(sim, (unsigned long long)(seqPtr - istart), h.seq_size, SIM_sequences, 0);
+        CSIM_access(sim, (unsigned long long)(litPtr - istart), 16, SIM_literals, 0);
+        CSIM_access(sim, op, 16, SIM_output, 0);
+        seqPtr += h.seq_size;
+        litPtr += ll;
+        nextBlock(h, seqNb + 1, &seqPtr, &litPtr);
+        op += ll;
+
+        assert(offset <= op - dstBase);
+        CSIM_access(sim, op - offset, ml > 32 ? ml : 32, SIM_matches, 0);
+        CSIM_access(sim, op, ml > 32 ? ml : 32, SIM_output, 0);
+        op += ml;
+    }
+
+    /* last literals */
+    {   size_t const lastLiterals = srcSize - h.checksum_size - h.extension_size - (size_t)(litPtr - istart);
+        CSIM_access(sim, (unsigned long long)(litPtr - istart), lastLiterals, SIM_literals, 0);
+        CSIM_access(sim, op, lastLiterals, SIM_output, 0);
+    }
+}
+
+
+/* Prefetch policy evaluation */
+
+static void prefetchMatch(CSIM_t* sim, unsigned long long source, prefetch_policy policy, unsigned long long* cycle)
+{
+    if (policy.nbLines == PREFETCH_LINES_WILDCOPY) {
+        CSIM_prefetch(sim, source, policy.hintLevel, SIM_matches, *cycle);
+        CSIM_prefetch(sim, source + 31, policy.hintLevel, SIM_matches, *cycle);
+        *cycle += 2 * EVAL_PREFETCH_CYCLES;
+        return;
+    }
+    for (int n = 0; n < policy.nbLines; n++)
+        CSIM_prefetch(sim, source + (unsigned long long)n * CSIM_LINE_SIZE, policy.hintLevel, SIM_matches, *cycle);
+    *cycle += (unsigned long long)policy.nbLines * EVAL_PREFETCH_CYCLES;
+}
+
+policy_eval evaluate_policy(CSIM_t* sim, const void* src, size_t srcSize, prefetch_policy policy)
+{
+    policy_eval pe;
+    frame_header const h = read_header(src, srcSize);
+    const char* const istart = (const char*)src;
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    const char* litAhead = litPtr;
+    const char* seqAhead = seqPtr;   /* sequence seqNb + depth */
+    size_t const nbSeqs = h.nb_sequences;
+    size_t const depth = (size_t)policy.depth < nbSeqs ? (size_t)policy.depth : nbSeqs;
+    unsigned const l1Latency = CSIM_getConfig(sim).cache[0].latency;
+    unsigned long long const dstBase = (srcSize / SIM_BUFFER_ALIGN + 1) * SIM_BUFFER_ALIGN;
+    unsigned long long op = dstBase + h.warmup_size;
+    unsigned long long vpos = op;   /* match position of sequence seqNb + depth */
+    unsigned long long cycle = 0;
+    const char* extPtr = extensionStream(h, src, srcSize);
+    const char* extAhead = extPtr;
+
+    assert(policy.depth >= 0 && policy.nbLines >= 0);
+    memset(&pe, 0, sizeof(pe));
+    CSIM_reset(sim);
+
+    for (size_t n = 0; n < depth; n++) {
+        size_t const ll = (unsigned char)seqAhead[0];
+        vpos += ll + readMatchLength(seqAhead, &extAhead);
+        seqAhead += h.seq_size;
+        litAhead += ll;
+        nextBlock(h, n + 1, &seqAhead, &litAhead);
+    }
+
+    for (size_t seqNb = 0; seqNb < nbSeqs; seqNb++) {
+        size_t const ll = (size_t)(unsigned char)seqPtr[0];
+        size_t const ml = readMatchLength(seqPtr, &extPtr);
+        size_t const offset = match_offset(h, seqPtr, (size_t)(op - dstBase) + ll);
+        unsigned latency = 0;
+
+        if (depth > 0 && seqNb + depth < nbSeqs) {
+            size_t const nextll = (unsigned char)seqAhead[0];
+            vpos += nextll;
+            prefetchMatch(sim, vpos - match_offset(h, seqAhead, (size_t)(vpos - dstBase)), policy, &cycle);
+            vpos += readMatchLength(seqAhead, &extAhead);
+            seqAhead += h.seq_size;
+            litAhead += nextll;
+            nextBlock(h, seqNb + depth + 1, &seqAhead, &litAhead);
+        }
+
+        {   unsigned const seqLatency = CSIM_access(sim, (unsigned long long)(seqPtr - istart), h.seq_size, SIM_sequences, cycle);
+            unsigned const litLatency = CSIM_access(sim, (unsigned long long)(litPtr - istart), 16, SIM_literals, cycle);
+            latency = seqLatency > litLatency ? seqLatency : litLatency;
+        }
+        CSIM_access(sim, op, 16, SIM_output, cycle);
+        seqPtr += h.seq_size;
+        litPtr += ll;
+        nextBlock(h, seqNb + 1, &seqPtr, &litPtr);
+        op += ll;
+
+        assert(offset <= op - dstBase);
+        {   unsigned const matchLatency = CSIM_access(sim, op - offset, ml > 32 ? ml : 32, SIM_matches, cycle);
+            if (matchLatency > latency) latency = matchLatency;
+        }
+        CSIM_access(sim, op, ml > 32 ? ml : 32, SIM_output, cycle);
+        op += ml;
+
+        if (latency > l1Latency) pe.stall_cycles += latency - l1Latency;
+        cycle += EVAL_SEQ_CYCLES + (latency > l1Latency ? latency - l1Latency : 0);
+    }
+
+    pe.cycles = cycle;
+    pe.counters = *CSIM_counters(sim);
+    pe.pf_unused = CSIM_pendingPrefetches(sim);
+    return pe;
+}
+
+
+/* Reordered decoding */
+
+static int cmpSize(const void* a, const void* b)
+{
+    size_t const x = *(const size_t*)a;
+    size_t const y = *(const size_t*)b;
+    return (x > y) - (x < y);
+}
+
+reorder_analysis analyze_reorder(const void* src, size_t srcSize, int windowSeqs)
+{
+    frame_header const h = read_header(src, srcSize);
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    size_t const nbSeqs = h.nb_sequences;
+    size_t const winSize = windowSeqs ? (size_t)windowSeqs : ZF_REORDER_WINDOW_DEFAULT;
+    size_t* const pages = malloc(winSize * sizeof(size_t)); assert(pages != NULL);
+    size_t pos = h.warmup_size;
+    const char* extPtr = extensionStream(h, src, srcSize);
+    reorder_analysis ra;
+    memset(&ra, 0, sizeof(ra));
+
+    for (size_t seqNb = 0; seqNb < nbSeqs; ra.nb_windows++) {
+        size_t const winStart = pos;
+        size_t nbPages = 0;
+        for (size_t n = 0; n < winSize && seqNb < nbSeqs; n++, seqNb++) {
+            size_t const ll = (size_t)(unsigned char)seqPtr[0];
+            size_t const ml = readMatchLength(seqPtr, &extPtr);
+            size_t const offset = match_offset(h, seqPtr, pos + ll);
+            seqPtr += h.seq_size;
+            litPtr += ll;
+            nextBlock(h, seqNb + 1, &seqPtr, &litPtr);
+            pos += ll;
+            if (ml) {
+                ra.nb_matches++;
+                /* long and overlapping matches execute in place */
+                if (ml <= 32 && offset >= 32 && pos - offset + ml <= winStart) pages[nbPages++] = (pos - offset) / ANALYSIS_PAGE_SIZE;
+            }
+            pos += ml;
+        }
+        ra.nb_final += nbPages;
+        qsort(pages, nbPages, sizeof(size_t), cmpSize);
+        for (size_t n = 0; n < nbPages; n++) ra.nb_final_pages += (n == 0 || pages[n] != pages[n-1]);
+    }
+
+    free(pages);
+    return ra;
+}
+
+
+/* Offset field entropy */
+
+double offset_field_entropy(const void* src, size_t srcSize)
+{
+    frame_header const h = read_header(src, srcSize);
+    int const nbLanes = (h.version >= 2) ? 6 : 4;
+    const char* litPtr;
+    const char* seqPtr = frame_sequences(src, h, &litPtr);
+    size_t (*const counts)[256] = calloc(6, sizeof(*counts));
+    double bits = 0;
+    assert(counts != NULL);
+
+    for (size_t seqNb = 0; seqNb < h.nb_sequences; seqNb++) {
+        for (int lane = 0; lane < nbLanes; lane++)
+            counts[lane][(unsigned char)seqPtr[2 + lane]]++;
+        litPtr += (unsigned char)seqPtr[0];
+        seqPtr += h.seq_size;
+        nextBlock(h, seqNb + 1, &seqPtr, &litPtr);
+    }
+
+    for (int lane = 0; lane < nbLanes && h.nb_sequences; lane++)
+        for (int b = 0; b < 256; b++) {
+            double const p = (double)counts[lane][b] / (double)h.nb_sequences;
+            if (counts[lane][b]) bits -= p * log2(p);
+        }
+
+    free(counts);
+    return bits;
+}
@@ -0,0 +1,106 @@
+#ifndef ZFSTATS_H
+#define ZFSTATS_H
+
+#include <stddef.h>   // size_t
+#include "zfdec.h"    // frame_stats
+#include "cachesim.h" // CSIM_t
+
+/* Frame analytics :
+ * distributions which decide whether prefetching helps,
+ * beyond the totals of collect_stats().
+ *
+ * Histograms are log-binned : bin 0 counts value 0,
+ * bin b > 0 counts values within [2^(b-1), 2^b).
+ *
+ * Reuse distance of a match source cache line is the nb of distinct cache lines
+ * touched by the decoder (output writes and match reads) since its previous access.
+ * Under LRU, a source is a hit in a cache of N lines when its distance is < N.
+ * Lines never accessed before within the frame, typically in warm up data, are cold. */
+
+#define ANALYSIS_LOG_BINS   50          /* values up to 2^49 */
+#define ANALYSIS_LINE_SIZE  64
+#define ANALYSIS_PAGE_SIZE  4096
+#define ANALYSIS_PAGES_BLOCK 1000000    /* nb of sequences per distinct pages count */
+
+typedef struct {
+    frame_stats basic;              /* same as collect_stats() */
+    size_t nb_matches;              /* sequences with a match length > 0 */
+    size_t ll_hist[ANALYSIS_LOG_BINS];
+    size_t ml_hist[ANALYSIS_LOG_BINS];
+    size_t offset_hist[ANALYSIS_LOG_BINS];   /* matches only */
+    size_t line_crossings;          /* match sources spanning 2 cache lines or more */
+    size_t page_crossings;          /* match sources spanning 2 pages */
+    size_t reuse_hist[ANALYSIS_LOG_BINS];    /* one entry per match source line */
+    size_t reuse_cold;
+    size_t nb_source_lines;         /* sum of reuse_hist[] and reuse_cold */
+    double pages_per_block;         /* average distinct pages touched per ANALYSIS_PAGES_BLOCK sequences */
+    size_t nb_page_blocks;          /* 0 : frame is shorter than one block, pages_per_block covers whole frame */
+} frame_analysis;
+
+/* analyze_frame() :
+ * working memory : original_size / 16 bytes + 16 bytes per sequence, for reuse distances. */
+frame_analysis analyze_frame(const void* src, size_t srcSize);
+
+/* simulate_frame() :
+ * replays the memory accesses of decompress() into `sim`, tagged by stream :
+ * sequence reads, literal reads, match reads at op - offset, and output writes.
+ * Copies are modelled with the decoder's wildcopy widths (16 bytes literals, 32 bytes matches).
+ * Buffers are laid out at fixed, page aligned addresses, so results don't depend on the host allocator.
+ * `sim` is not reset : counters accumulate. */
+typedef enum { SIM_sequences, SIM_literals, SIM_matches, SIM_output, SIM_NB_STREAMS } sim_stream_e;
+
+void simulate_frame(CSIM_t* sim, const void* src, size_t srcSize);
+
+const char* simulate_streamName(sim_stream_e stream);
+
+/* Prefetch policy evaluation :
+ * replays the frame like simulate_frame(), on a simple in-order timing model :
+ * each sequence costs EVAL_SEQ_CYCLES plus each prefetch EVAL_PREFETCH_CYCLES,
+ * plus a stall on the slowest of its loads (sequence, literals, match) beyond L1 latency.
+ * Stores never stall. Prefetches follow decompress_pref() : at sequence n,
+ * the match source of sequence n + depth is prefetched.
+ * Every prefetch is classified by the model : timely, late, redundant, evicted, or left unused. */
+#define EVAL_SEQ_CYCLES      6
+#define EVAL_PREFETCH_CYCLES 1
+#define PREFETCH_LINES_WILDCOPY 0   /* match start and start + 31, like decompress_pref() */
+
+typedef struct {
+    int depth;        /* lookahead in sequences, like prefRounds; 0 : no prefetch */
+    int nbLines;      /* lines from match start, or PREFETCH_LINES_WILDCOPY */
+    int hintLevel;    /* cache level filled : 0 = L1 (T0), 1 = L2 (T1), 2 = LLC (T2) */
+} prefetch_policy;
+
+typedef struct {
+    unsigned long long cycles;
+    unsigned long long stall_cycles;
+    CSIM_counters_t counters;       /* prefetch classification in pf* fields */
+    unsigned long long pf_unused;   /* still pending at end of frame */
+} policy_eval;
+
+/* evaluate_policy() : resets `sim` first.
+ * `policy.hintLevel` must be a level of `sim` */
+policy_eval evaluate_policy(CSIM_t* sim, const void* src, size_t srcSize, prefetch_policy policy);
+
+/* analyze_reorder() :
+ * what decompress_reorder() can regroup, with windows of `windowSeqs` sequences (0 : default) :
+ * final matches have their source before their window,
+ * and are executed once per distinct source page of their window. */
+typedef struct {
+    size_t nb_matches;
+    size_t nb_final;
+    size_t nb_final_pages;    /* sum over windows of distinct source pages of final matches */
+    size_t nb_windows;
+} reorder_analysis;
+
+reorder_analysis analyze_reorder(const void* src, size_t srcSize, int windowSeqs);
+
+/* offset_field_entropy() :
+ * order-0 entropy of offset fields, each byte of the field being a separate symbol stream,
+ * in bits per sequence : the cost an entropy stage would pay for them,
+ * to compare relative offsets with absolute positions (ZF_FLAG_ABSOLUTE) beyond raw field size */
+double offset_field_entropy(const void* src, size_t srcSize);
+
+/* log2 bin of `value`, see above */
+int analysis_bin(unsigned long long value);
+
+#endif  /* ZFSTATS_H */
@@ -0,0 +1,142 @@
+/* Sequence trace import,
+ * see zftrace.h for file formats */
+
+#include <stddef.h>   // size_t
+#include <stdlib.h>   // malloc, strtoull
+#include <stdio.h>    // fopen, fprintf
+#include <string.h>   // memcmp
+#include <ctype.h>    // isdigit
+#include <assert.h>
+
+#include "util.h"     // UTIL_getFileSize
+#include "zftrace.h"
+
+
+#define TRACE_ERROR(...)  { fprintf(stderr, "trace error : " __VA_ARGS__); fprintf(stderr, " \n"); }
+
+static unsigned readLE32(const unsigned char* p)
+{
+    return (unsigned)p[0] | ((unsigned)p[1] << 8) | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static size_t parse_binary(zf_seq* seqs, const unsigned char* src, size_t srcSize)
+{
+    size_t const recordSize = 12;
+    size_t const nbSeqs = (srcSize - 4) / recordSize;
+    const unsigned char* ip = src + 4;
+    assert(srcSize >= 4);
+    if ((srcSize - 4) % recordSize)
+        TRACE_ERROR("binary trace size is not a multiple of %zu, ignoring last record", recordSize);
+    for (size_t n=0; n < nbSeqs; n++) {
+        seqs[n].ll = readLE32(ip);
+        seqs[n].ml = readLE32(ip + 4);
+        seqs[n].offset = readLE32(ip + 8);
+        ip += recordSize;
+    }
+    return nbSeqs;
+}
+
+/* @return : nb of values read on current line (0, or 3 for a valid record),
+ *           or -1 if line is not made of numbers */
+static int parse_csvLine(zf_seq* seq, const char** linePtr, const char* end)
+{
+    const char* p = *linePtr;
+    unsigned long long values[3];
+    int nbValues = 0;
+    int invalid = 0;
+    const char* const lineEnd = memchr(p, '\n', (size_t)(end - p));
+    const char* const eol = lineEnd ? lineEnd : end;
+    *linePtr = lineEnd ? lineEnd + 1 : end;
+
+    while (p < eol && isspace((unsigned char)*p)) p++;
+    if (p == eol || *p == '#') return 0;
+
+    while (p < eol) {
+        if (isdigit((unsigned char)*p)) {
+            char* next;
+            if (nbValues < 3) values[nbValues] = strtoull(p, &next, 10);
+            else (void)strtoull(p, &next, 10);
+            nbValues++;
+            p = next;
+        } else if (*p == ',' || *p == ';' || isspace((unsigned char)*p)) {
+            p++;
+        } else {
+            invalid = 1;
+            p++;
+        }
+    }
+    if (invalid || nbValues != 3) return -1;
+    for (int i=0; i<3; i++) if (values[i] > 0xFFFFFFFFULL) return -1;
+    seq->ll = (unsigned)values[0];
+    seq->ml = (unsigned)values[1];
+    seq->offset = (unsigned)values[2];
+    return 3;
+}
+
+static size_t parse_csv(zf_seq* seqs, const char* src, size_t srcSize)
+{
+    const char* p = src;
+    const char* const end = src + srcSize;
+    size_t nbSeqs = 0;
+    unsigned lineNb = 0;
+    while (p < end) {
+        lineNb++;
+        int const r = parse_csvLine(seqs + nbSeqs, &p, end);
+        if (r == 3) { nbSeqs++; continue; }
+        if (r < 0) {
+            if (nbSeqs == 0 && lineNb == 1) continue;   /* header */
+            TRACE_ERROR("line %u is not a valid record", lineNb);
+            return (size_t)-1;
+        }
+    }
+    return nbSeqs;
+}
+
+buff load_trace(const char* fileName)
+{
+    buff const error = { NULL, 0 };
+    U64 const fileSize = UTIL_getFileSize(fileName);
+    if (fileSize == UTIL_FILESIZE_UNKNOWN || fileSize == 0) {
+        TRACE_ERROR("cannot read size of %s", fileName);
+        return error;
+    }
+
+    size_t const srcSize = (size_t)fileSize;
+    char* const src = malloc(srcSize);
+    if (src == NULL) { TRACE_ERROR("not enough memory"); return error; }
+    {   FILE* const f = fopen(fileName, "rb");
+        size_t readSize = 0;
+        if (f != NULL) {
+            readSize = fread(src, 1, srcSize, f);
+            fclose(f);
+        }
+        if (readSize != srcSize) {
+            TRACE_ERROR("cannot read %s", fileName);
+            free(src);
+            return error;
+    }   }
+
+    /* a CSV record takes at least 6 bytes ("0,0,0\n"), a binary one 12 bytes */
+    zf_seq* const seqs = malloc((srcSize / 6 + 1) * sizeof(zf_seq));
+    if (seqs == NULL) { TRACE_ERROR("not enough memory"); free(src); return error; }
+
+    size_t nbSeqs;
+    if (srcSize >= 4 && !memcmp(src, ZFTRACE_MAGIC, 4)) {
+        nbSeqs = parse_binary(seqs, (const unsigned char*)src, srcSize);
+    } else {
+        nbSeqs = parse_csv(seqs, src, srcSize);
+    }
+    free(src);
+
+    buff result = error;
+    if (nbSeqs == (size_t)-1) {
+        /* error already displayed */
+    } else if (nbSeqs == 0) {
+        TRACE_ERROR("no sequence in %s", fileName);
+    } else {
+        result = build_frame(seqs, nbSeqs);
+        if (result.buffer == NULL) TRACE_ERROR("%s is too large for frame format", fileName);
+    }
+    free(seqs);
+    return result;
+}
@@ -0,0 +1,24 @@
+#ifndef ZFTRACE_H
+#define ZFTRACE_H
+
+#include "zfgen.h"   // buff, zf_seq
+
+/* Sequence traces :
+ * captured (literal length, match length, offset) triples,
+ * replayed through the decoders as a synthesized frame.
+ *
+ * Two file formats are accepted :
+ * - binary : 4-bytes magic "ZFT1", followed by 12-bytes records,
+ *            each one made of 3 little-endian 32-bit values : ll, ml, offset
+ * - CSV : one sequence per line, "ll,ml,offset".
+ *         empty lines, lines starting with '#' and a header line are ignored.
+ */
+
+#define ZFTRACE_MAGIC "ZFT1"
+
+/* load_trace() :
+ * read trace file `fileName`, and build a frame from its sequences.
+ * @return : frame, or .buffer==NULL on error (error message already displayed) */
+buff load_trace(const char* fileName);
+
+#endif  /* ZFTRACE_H */